@@ -3,38 +3,87 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <stdarg.h>
+
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 
 #include "hgledon.h"
 
 #define MAX_BUF 64
+#define MAX_HANDLES 8
+#define MAX_LINE_REQS 4
 
-GPIO_PINS get_pins(int major, int minor)
-{
-    GPIO_PINS pins;
-    if (major >= 6)
+static GPIO_HANDLE handles[MAX_HANDLES];
+static int handle_count;
+
+static GPIO_LINES line_reqs[MAX_LINE_REQS];
+static int line_req_count;
+static gpio_backend_t gpio_backend = GPIO_BACKEND_SYSFS;
+static GPIO_COUNTERS gpio_stats;
+
+// The IR lines differ: they are where the fixed numbers of the older
+// releases (580 on 6.x, 507 on 5.15) land, and neither has been checked
+// against the board. Kept as they were so 'ir' drives the same pin.
+static const BOARD_PROFILE profiles[] = {
     {
-        pins = (GPIO_PINS){{547, 548}, {521, 517}, 580};
-    }
-    else if (major == 5 && minor == 15)
+        .name = "hg680p-6.x",
+        .kernel_major = 6,
+        .kernel_minor = -1,
+        .power = {{"periphs-banks", 24}, {"periphs-banks", 25}},
+        .lan = {{"aobus-banks", 9}, {"aobus-banks", 5}},
+        .ir = {"periphs-banks", 57},
+        .legacy = {{547, 548}, {521, 517}, 580},
+    },
     {
-        pins = (GPIO_PINS){{425, 426}, {510, 506}, 507};
+        .name = "hg680p-5.15",
+        .kernel_major = 5,
+        .kernel_minor = 15,
+        .power = {{"periphs-banks", 24}, {"periphs-banks", 25}},
+        .lan = {{"aobus-banks", 9}, {"aobus-banks", 5}},
+        .ir = {"aobus-banks", 6},
+        .legacy = {{425, 426}, {510, 506}, 507},
+    },
+};
+
+static int profile_matches(const BOARD_PROFILE *p, int major, int minor)
+{
+    return p->kernel_minor < 0 ? major >= p->kernel_major : major == p->kernel_major && minor == p->kernel_minor;
+}
+
+const BOARD_PROFILE *find_profile(int major, int minor)
+{
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+    {
+        if (profile_matches(&profiles[i], major, minor))
+            return &profiles[i];
     }
-    else
+    return NULL;
+}
+
+GPIO_PINS get_pins(int major, int minor)
+{
+    const BOARD_PROFILE *p = find_profile(major, minor);
+
+    if (!p)
     {
         fprintf(stderr, "Unsupported kernel version\n");
         exit(1);
     }
-    return pins;
+    return p->legacy;
 }
 
 void export_gpio(int pin)
 {
-    char path[MAX_BUF];
-    snprintf(path, MAX_BUF, "/sys/class/gpio/gpio%d/value", pin);
+    char path[MAX_BUF * 4];
+    hgl_path(path, sizeof(path), "/sys/class/gpio/gpio%d/value", pin);
     if (access(path, F_OK) == 0)
         return;
 
-    int fd = open("/sys/class/gpio/export", O_WRONLY);
+    hgl_path(path, sizeof(path), "/sys/class/gpio/export");
+    int fd = open(path, O_WRONLY);
     if (fd < 0)
     {
         perror("Failed to export GPIO");
@@ -46,8 +95,8 @@ void export_gpio(int pin)
 
 void set_gpio_direction(int pin, const char *direction)
 {
-    char path[MAX_BUF];
-    snprintf(path, MAX_BUF, "/sys/class/gpio/gpio%d/direction", pin);
+    char path[MAX_BUF * 4];
+    hgl_path(path, sizeof(path), "/sys/class/gpio/gpio%d/direction", pin);
     int fd = open(path, O_WRONLY);
     if (fd < 0)
     {
@@ -58,18 +107,397 @@ void set_gpio_direction(int pin, const char *direction)
     close(fd);
 }
 
-void set_gpio_value(int pin, int value)
+GPIO_HANDLE *gpio_open(int pin)
+{
+    for (int i = 0; i < handle_count; i++)
+    {
+        if (handles[i].pin == pin)
+            return &handles[i];
+    }
+
+    if (handle_count >= MAX_HANDLES)
+    {
+        fprintf(stderr, "Too many GPIO handles\n");
+        return NULL;
+    }
+
+    export_gpio(pin);
+    set_gpio_direction(pin, "out");
+
+    char path[MAX_BUF * 4];
+    hgl_path(path, sizeof(path), "/sys/class/gpio/gpio%d/value", pin);
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("Failed to open GPIO value");
+        return NULL;
+    }
+
+    // Seed the shadow register from the line so the first write can be skipped too
+    char buf[4];
+    int value = -1;
+    if (pread(fd, buf, sizeof(buf), 0) > 0 && (buf[0] == '0' || buf[0] == '1'))
+        value = buf[0] - '0';
+
+    GPIO_HANDLE *h = &handles[handle_count++];
+    h->pin = pin;
+    h->fd = fd;
+    h->value = value;
+    return h;
+}
+
+void gpio_close_all(void)
+{
+    for (int i = 0; i < handle_count; i++)
+        close(handles[i].fd);
+    handle_count = 0;
+
+    for (int i = 0; i < line_req_count; i++)
+        close(line_reqs[i].fd);
+    line_req_count = 0;
+}
+
+void gpio_set_backend(gpio_backend_t backend)
+{
+    gpio_backend = backend;
+}
+
+const GPIO_COUNTERS *gpio_counters(void)
+{
+    return &gpio_stats;
+}
+
+static int read_attr(const char *path, char *buf, size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n <= 0)
+        return -1;
+
+    buf[n] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// Map a global (sysfs) GPIO number to the chardev and line offset that owns it
+static int gpio_chip_lookup(int pin, char *dev, size_t size, int *offset)
+{
+    char path[MAX_BUF * 4];
+    char buf[MAX_BUF];
+    char label[GPIO_MAX_NAME_SIZE] = "";
+    int ngpio = 0;
+    int found = 0;
+    struct dirent *entry;
+
+    hgl_path(path, sizeof(path), "/sys/class/gpio");
+    DIR *d = opendir(path);
+    if (!d)
+        return -1;
+
+    while ((entry = readdir(d)) != NULL)
+    {
+        int base;
+        if (sscanf(entry->d_name, "gpiochip%d", &base) != 1)
+            continue;
+
+        hgl_path(path, sizeof(path), "/sys/class/gpio/%s/ngpio", entry->d_name);
+        if (read_attr(path, buf, sizeof(buf)) < 0)
+            continue;
+        ngpio = atoi(buf);
+        if (pin < base || pin >= base + ngpio)
+            continue;
+
+        hgl_path(path, sizeof(path), "/sys/class/gpio/%s/label", entry->d_name);
+        if (read_attr(path, label, sizeof(label)) == 0)
+        {
+            *offset = pin - base;
+            found = 1;
+        }
+        break;
+    }
+    closedir(d);
+
+    if (!found)
+        return -1;
+
+    hgl_path(path, sizeof(path), "/dev");
+    d = opendir(path);
+    if (!d)
+        return -1;
+
+    found = 0;
+    while (!found && (entry = readdir(d)) != NULL)
+    {
+        if (strncmp(entry->d_name, "gpiochip", 8) != 0)
+            continue;
+
+        // A node whose path doesn't fit the caller's buffer can't be handed back
+        if (hgl_path(path, sizeof(path), "/dev/%s", entry->d_name) < 0 || strlen(path) >= size)
+            continue;
+
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        struct gpiochip_info info;
+        memset(&info, 0, sizeof(info));
+        if (ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info) == 0 &&
+            strcmp(info.label, label) == 0 && (int)info.lines == ngpio)
+        {
+            memcpy(dev, path, strlen(path) + 1);
+            found = 1;
+        }
+        close(fd);
+    }
+    closedir(d);
+
+    return found ? 0 : -1;
+}
+
+typedef struct
+{
+    char label[GPIO_MAX_NAME_SIZE];
+    int base;
+} CHIP_BASE;
+
+static int chip_line(const CHIP_BASE *chips, int count, const GPIO_LINE_REF *ref)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(chips[i].label, ref->chip) == 0)
+            return chips[i].base + ref->offset;
+    }
+    return -1;
+}
+
+// Global numbers for a profile from the bases its chips got at boot; -1 if a chip is missing
+int resolve_pins(const BOARD_PROFILE *profile, GPIO_PINS *pins)
+{
+    CHIP_BASE *chips = NULL;
+    int count = 0;
+    char path[MAX_BUF * 4];
+    char buf[MAX_BUF];
+    struct dirent *entry;
+
+    hgl_path(path, sizeof(path), "/sys/class/gpio");
+    DIR *d = opendir(path);
+    if (!d)
+        return -1;
+
+    while ((entry = readdir(d)) != NULL)
+    {
+        if (strncmp(entry->d_name, "gpiochip", 8) != 0)
+            continue;
+
+        hgl_path(path, sizeof(path), "/sys/class/gpio/%s/base", entry->d_name);
+        if (read_attr(path, buf, sizeof(buf)) < 0)
+            continue;
+
+        CHIP_BASE *tmp = realloc(chips, (count + 1) * sizeof(*chips));
+        if (!tmp)
+        {
+            closedir(d);
+            free(chips);
+            return -1;
+        }
+        chips = tmp;
+        chips[count].base = atoi(buf);
+
+        hgl_path(path, sizeof(path), "/sys/class/gpio/%s/label", entry->d_name);
+        if (read_attr(path, chips[count].label, sizeof(chips[count].label)) == 0)
+            count++;
+    }
+    closedir(d);
+
+    GPIO_PINS p = {
+        {chip_line(chips, count, &profile->power[0]), chip_line(chips, count, &profile->power[1])},
+        {chip_line(chips, count, &profile->lan[0]), chip_line(chips, count, &profile->lan[1])},
+        chip_line(chips, count, &profile->ir),
+    };
+    free(chips);
+
+    if (p.power[0] < 0 || p.power[1] < 0 || p.lan[0] < 0 || p.lan[1] < 0 || p.ir < 0)
+        return -1;
+    *pins = p;
+    return 0;
+}
+
+static void unexport_gpio(int pin)
 {
-    char path[MAX_BUF];
-    snprintf(path, MAX_BUF, "/sys/class/gpio/gpio%d/value", pin);
+    char path[MAX_BUF * 4];
+
+    hgl_path(path, sizeof(path), "/sys/class/gpio/unexport");
     int fd = open(path, O_WRONLY);
     if (fd < 0)
+        return;
+    dprintf(fd, "%d", pin);
+    close(fd);
+}
+
+GPIO_LINES *gpio_find_lines(int pin, int count)
+{
+    for (int i = 0; i < line_req_count; i++)
+    {
+        if (line_reqs[i].pins[0] == pin && line_reqs[i].count == count)
+            return &line_reqs[i];
+    }
+    return NULL;
+}
+
+GPIO_LINES *gpio_request_lines(const int *pins, int count)
+{
+    // Chardevs are looked up below the root prefix too, so a test tree can link
+    // in gpio-sim chips; one without them falls back to sysfs
+    if (gpio_backend == GPIO_BACKEND_SYSFS || count < 1 || count > 2)
+        return NULL;
+
+    GPIO_LINES *l = gpio_find_lines(pins[0], count);
+    if (l)
+        return l;
+
+    if (line_req_count >= MAX_LINE_REQS)
+        return NULL;
+
+    char dev[MAX_BUF * 4], other[MAX_BUF * 4];
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+
+    for (int i = 0; i < count; i++)
+    {
+        int offset;
+        if (gpio_chip_lookup(pins[i], i ? other : dev, sizeof(dev), &offset) < 0)
+            return NULL;
+        // Both lines of a bicolor LED must live on one chip to share a request
+        if (i && strcmp(dev, other) != 0)
+            return NULL;
+        req.offsets[i] = offset;
+    }
+
+    int chip = open(dev, O_RDWR | O_CLOEXEC);
+    if (chip < 0)
+        return NULL;
+
+    req.num_lines = count;
+    req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    snprintf(req.consumer, sizeof(req.consumer), "hgledon");
+
+    int ret = ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &req);
+    if (ret < 0 && errno == EBUSY)
+    {
+        // Lines left exported by an earlier sysfs run; release them and retry
+        for (int i = 0; i < count; i++)
+            unexport_gpio(pins[i]);
+        ret = ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &req);
+    }
+    close(chip);
+
+    if (ret < 0)
+        return NULL;
+
+    l = &line_reqs[line_req_count++];
+    l->pins[0] = pins[0];
+    l->pins[1] = count > 1 ? pins[1] : -1;
+    l->count = count;
+    l->fd = req.fd;
+    l->values = 0; // output lines are requested driven low
+    return l;
+}
+
+int gpio_set_lines(GPIO_LINES *lines, unsigned int values)
+{
+    unsigned int mask = (1u << lines->count) - 1;
+
+    values &= mask;
+    if (lines->values == (int)values)
+    {
+        gpio_stats.elided++;
+        return 0;
+    }
+
+    gpio_stats.issued++;
+    struct gpio_v2_line_values lv = {.bits = values, .mask = mask};
+    if (ioctl(lines->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) < 0)
+    {
+        perror("Failed to set GPIO line values");
+        lines->values = -1;
+        return -1;
+    }
+    lines->values = values;
+    return 0;
+}
+
+void set_gpio_value(int pin, int value)
+{
+    GPIO_HANDLE *h = gpio_open(pin);
+    if (!h)
+        return;
+
+    value = value ? 1 : 0;
+    if (h->value == value)
+    {
+        gpio_stats.elided++;
+        return;
+    }
+
+    gpio_stats.issued++;
+    if (pwrite(h->fd, value ? "1" : "0", 1, 0) != 1)
     {
         perror("Failed to set GPIO value");
+        h->value = -1;
         return;
     }
-    dprintf(fd, "%d", value);
-    close(fd);
+    h->value = value;
+}
+
+int gpio_pair_open(int pin_on, int pin_off, GPIO_PAIR *pair)
+{
+    memset(pair, 0, sizeof(*pair));
+
+    GPIO_LINES *l = gpio_find_lines(pin_on, 2);
+    if (l && l->pins[1] == pin_off)
+    {
+        pair->lines = l;
+        return 0;
+    }
+
+    pair->handles[0] = gpio_open(pin_on);
+    pair->handles[1] = gpio_open(pin_off);
+    return pair->handles[0] && pair->handles[1] ? 0 : -1;
+}
+
+// Bit 0 drives pin_on, bit 1 pin_off. Skips the shadow values and counters, which
+// belong to the main thread; call gpio_pair_release once the writer is done.
+int gpio_pair_write(const GPIO_PAIR *pair, unsigned int values)
+{
+    if (pair->lines)
+    {
+        struct gpio_v2_line_values lv = {.bits = values & 3, .mask = 3};
+        return ioctl(pair->lines->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (pwrite(pair->handles[i]->fd, values & (1u << i) ? "1" : "0", 1, 0) != 1)
+            return -1;
+    }
+    return 0;
+}
+
+// Forget the shadow values so the next regular write is always issued
+void gpio_pair_release(GPIO_PAIR *pair)
+{
+    if (pair->lines)
+        pair->lines->values = -1;
+    for (int i = 0; i < 2; i++)
+    {
+        if (pair->handles[i])
+            pair->handles[i]->value = -1;
+    }
+    memset(pair, 0, sizeof(*pair));
 }
 
 void lp_control(const char *act, int pin_on, int pin_off)
@@ -81,11 +509,6 @@ void lp_control(const char *act, int pin_on, int pin_off)
         exit(1);
     }
 
-    export_gpio(pin_on);
-    export_gpio(pin_off);
-    set_gpio_direction(pin_on, "out");
-    set_gpio_direction(pin_off, "out");
-
     int values[4][2] = {
         {1, 0}, // on
         {0, 1}, // off
@@ -103,6 +526,13 @@ void lp_control(const char *act, int pin_on, int pin_off)
     else
         index = 3; // "dis"
 
+    GPIO_LINES *l = gpio_find_lines(pin_on, 2);
+    if (l && l->pins[1] == pin_off)
+    {
+        gpio_set_lines(l, values[index][0] | values[index][1] << 1);
+        return;
+    }
+
     set_gpio_value(pin_on, values[index][0]);
     set_gpio_value(pin_off, values[index][1]);
 }
@@ -116,15 +546,20 @@ void ir_control(const char *ir_action, int pin_ir)
         exit(1);
     }
 
-    export_gpio(pin_ir);
-    set_gpio_direction(pin_ir, "out");
+    GPIO_LINES *l = gpio_find_lines(pin_ir, 1);
 
-    set_gpio_value(pin_ir, strcmp(ir_action, "dis") != 0);
+    if (l)
+        gpio_set_lines(l, strcmp(ir_action, "dis") != 0);
+    else
+        set_gpio_value(pin_ir, strcmp(ir_action, "dis") != 0);
 
     if (strcmp(ir_action, "reset") == 0)
     {
         usleep(100000);
-        set_gpio_value(pin_ir, 0);
+        if (l)
+            gpio_set_lines(l, 0);
+        else
+            set_gpio_value(pin_ir, 0);
     }
 }
 
@@ -158,13 +593,19 @@ void usage(GPIO_PINS pins, const char *kernel_version)
     printf("  hgledon lan [on, off, warn, dis]\n");
     printf("  hgledon ir [on, dis, reset]\n");
     printf("  hgledon help (to show this message)\n");
+    printf("\nEnvironment:\n  HGLEDON_BACKEND=sysfs|cdev|auto  GPIO access method (default sysfs)\n");
+    printf("  HGLEDON_PINS=p0,p1,l0,l1,ir      override the pin table\n");
+    printf("  HGLEDON_ROOT=<dir>               read sysfs/procfs below <dir> (testing)\n");
+    printf("\nPins are resolved from the gpiochip labels once per boot and cached in %s.\n", PIN_CACHE);
 }
 
-GPIO_PINS init_gpio(char *kernel_version)
+// An unparsable release leaves major and minor at 0, which no profile matches
+static void read_kernel_version(char *kernel_version, int *major, int *minor)
 {
-    int major = 0, minor = 0;
+    char path[MAX_BUF * 4];
 
-    FILE *f = fopen("/proc/sys/kernel/osrelease", "r");
+    hgl_path(path, sizeof(path), "/proc/sys/kernel/osrelease");
+    FILE *f = fopen(path, "r");
     if (!f)
     {
         perror("Failed to open /proc/sys/kernel/osrelease");
@@ -178,13 +619,270 @@ GPIO_PINS init_gpio(char *kernel_version)
     }
     fclose(f);
 
-    if (sscanf(kernel_version, "%d.%d", &major, &minor) != 2)
+    kernel_version[strcspn(kernel_version, "\n")] = '\0';
+
+    if (sscanf(kernel_version, "%d.%d", major, minor) != 2)
+        *major = *minor = 0;
+}
+
+// "<p0>,<p1>,<l0>,<l1>,<ir> <kernel> <profile>", written by the first start after boot
+static int read_pin_cache(GPIO_PINS *pins, char *kernel_version)
+{
+    char path[MAX_BUF * 4];
+    char line[MAX_BUF * 2];
+
+    hgl_path(path, sizeof(path), PIN_CACHE);
+    if (read_attr(path, line, sizeof(line)) < 0)
+        return -1;
+
+    return sscanf(line, "%d,%d,%d,%d,%d %63s", &pins->power[0], &pins->power[1],
+                  &pins->lan[0], &pins->lan[1], &pins->ir, kernel_version) == 6 ? 0 : -1;
+}
+
+static void write_pin_cache(const GPIO_PINS *pins, const char *kernel_version, const char *profile)
+{
+    char path[MAX_BUF * 4];
+    char tmp[MAX_BUF * 4 + 4];
+
+    hgl_path(path, sizeof(path), PIN_CACHE);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return;
+    dprintf(fd, "%d,%d,%d,%d,%d %s %s\n", pins->power[0], pins->power[1],
+            pins->lan[0], pins->lan[1], pins->ir, kernel_version, profile);
+    close(fd);
+
+    // Readers see either no cache or a whole one
+    if (rename(tmp, path) < 0)
+        unlink(tmp);
+}
+
+// Locate the lines of every profile by chip label; among the profiles whose
+// chips are all present, the running kernel picks, and an unknown kernel
+// takes the first. With no chips found, the legacy numbers of the kernel's
+// profile are used. Only resolved numbers are cached: early in boot the
+// chips may not be probed yet, and the next start should look again.
+static GPIO_PINS discover_pins(char *kernel_version)
+{
+    int major = 0, minor = 0;
+    const BOARD_PROFILE *found = NULL;
+    GPIO_PINS pins, p_pins;
+
+    read_kernel_version(kernel_version, &major, &minor);
+
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+    {
+        const BOARD_PROFILE *p = &profiles[i];
+
+        if (resolve_pins(p, &p_pins) < 0 || (found && !profile_matches(p, major, minor)))
+            continue;
+        if (!found || !profile_matches(found, major, minor))
+        {
+            found = p;
+            pins = p_pins;
+        }
+    }
+
+    if (found)
     {
-        fprintf(stderr, "Error parsing kernel version: %s\n", kernel_version);
+        write_pin_cache(&pins, kernel_version, found->name);
+        return pins;
+    }
+
+    const BOARD_PROFILE *p = find_profile(major, minor);
+    if (!p)
+    {
+        fprintf(stderr, "Unsupported kernel version %s and no known GPIO chips\n", kernel_version);
         exit(1);
     }
+    return p->legacy;
+}
+
+GPIO_PINS init_gpio(char *kernel_version)
+{
+    GPIO_PINS pins;
+    const char *override = getenv("HGLEDON_PINS");
+
+    if (override)
+    {
+        int major, minor;
+
+        read_kernel_version(kernel_version, &major, &minor);
+        if (sscanf(override, "%d,%d,%d,%d,%d", &pins.power[0], &pins.power[1],
+                   &pins.lan[0], &pins.lan[1], &pins.ir) != 5)
+        {
+            fprintf(stderr, "Error parsing HGLEDON_PINS: %s\n", override);
+            exit(1);
+        }
+    }
+    else if (read_pin_cache(&pins, kernel_version) < 0)
+    {
+        pins = discover_pins(kernel_version);
+    }
+
+    const char *backend = getenv("HGLEDON_BACKEND");
+    if (backend)
+    {
+        if (strcmp(backend, "cdev") == 0)
+            gpio_set_backend(GPIO_BACKEND_CDEV);
+        else if (strcmp(backend, "auto") == 0)
+            gpio_set_backend(GPIO_BACKEND_AUTO);
+        else
+            gpio_set_backend(GPIO_BACKEND_SYSFS);
+    }
+
+    if (!gpio_request_lines(pins.power, 2))
+    {
+        gpio_open(pins.power[0]);
+        gpio_open(pins.power[1]);
+    }
+    if (!gpio_request_lines(pins.lan, 2))
+    {
+        gpio_open(pins.lan[0]);
+        gpio_open(pins.lan[1]);
+    }
+    if (!gpio_request_lines(&pins.ir, 1))
+        gpio_open(pins.ir);
+
+    if (gpio_backend == GPIO_BACKEND_CDEV && line_req_count == 0)
+        fprintf(stderr, "GPIO chardev unavailable, using sysfs\n");
+
+    return pins;
+}
+
+// $HGLEDON_ROOT, or NULL when the real sysfs/procfs are used
+const char *hgl_root(void)
+{
+    const char *root = getenv("HGLEDON_ROOT");
+
+    return root && root[0] ? root : NULL;
+}
+
+// Prefix sysfs/procfs paths with $HGLEDON_ROOT so they can point at a fake tree
+int hgl_path(char *buf, size_t size, const char *fmt, ...)
+{
+    const char *root = hgl_root();
+    int n = snprintf(buf, size, "%s", root ? root : "");
+
+    if (n < 0 || (size_t)n >= size)
+        return -1;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int m = vsnprintf(buf + n, size - n, fmt, ap);
+    va_end(ap);
+
+    return (m < 0 || (size_t)m >= size - n) ? -1 : 0;
+}
+
+static int ledcls_write(const LED_CLASS *led, const char *attr, const char *value)
+{
+    char path[MAX_BUF * 4];
+
+    if (hgl_path(path, sizeof(path), "/sys/class/leds/%s/%s", led->name, attr) < 0)
+        return -1;
+
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    ssize_t len = strlen(value);
+    ssize_t n = write(fd, value, len);
+    close(fd);
+    return n == len ? 0 : -1;
+}
+
+int ledcls_open(const char *name, LED_CLASS *led)
+{
+    char path[MAX_BUF * 4];
+    char buf[16];
+
+    memset(led, 0, sizeof(*led));
+    snprintf(led->name, sizeof(led->name), "%s", name);
+    led->interval_fd = -1;
+    led->interval = -1;
+    led->max_brightness = 1;
+
+    if (hgl_path(path, sizeof(path), "/sys/class/leds/%s/max_brightness", name) == 0 &&
+        read_attr(path, buf, sizeof(buf)) == 0 && atoi(buf) > 0)
+        led->max_brightness = atoi(buf);
+
+    if (hgl_path(path, sizeof(path), "/sys/class/leds/%s/brightness", name) < 0)
+        return -1;
+
+    led->brightness_fd = open(path, O_RDWR | O_CLOEXEC);
+    return led->brightness_fd < 0 ? -1 : 0;
+}
+
+void ledcls_close(LED_CLASS *led)
+{
+    if (led->brightness_fd >= 0)
+        close(led->brightness_fd);
+    if (led->interval_fd >= 0)
+        close(led->interval_fd);
+    led->brightness_fd = -1;
+    led->interval_fd = -1;
+}
+
+int ledcls_set_trigger(LED_CLASS *led, const char *trigger)
+{
+    if (led->interval_fd >= 0)
+    {
+        close(led->interval_fd);
+        led->interval_fd = -1;
+    }
+    return ledcls_write(led, "trigger", trigger);
+}
 
-    return get_pins(major, minor);
+int ledcls_set_brightness(LED_CLASS *led, int value)
+{
+    char buf[16];
+    int n = snprintf(buf, sizeof(buf), "%d", value);
+
+    return pwrite(led->brightness_fd, buf, n, 0) == n ? 0 : -1;
+}
+
+// Hand the LED to the kernel netdev trigger; the blinking then needs no userspace work
+int ledcls_netdev(LED_CLASS *led, const char *ifname, int interval_ms)
+{
+    char path[MAX_BUF * 4];
+
+    if (ledcls_set_trigger(led, "netdev") < 0)
+        return -1;
+    if (ledcls_write(led, "device_name", ifname) < 0)
+        return -1;
+
+    ledcls_write(led, "link", "1");
+    ledcls_write(led, "rx", "1");
+    ledcls_write(led, "tx", "1");
+
+    if (hgl_path(path, sizeof(path), "/sys/class/leds/%s/interval", led->name) < 0)
+        return -1;
+    led->interval_fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (led->interval_fd < 0)
+        return -1;
+
+    led->interval = -1;
+    return ledcls_set_interval(led, interval_ms);
+}
+
+int ledcls_set_interval(LED_CLASS *led, int interval_ms)
+{
+    char buf[16];
+
+    if (led->interval == interval_ms)
+        return 0;
+    if (led->interval_fd < 0)
+        return -1;
+
+    int n = snprintf(buf, sizeof(buf), "%d", interval_ms);
+    if (pwrite(led->interval_fd, buf, n, 0) != n)
+        return -1;
+
+    led->interval = interval_ms;
+    return 0;
 }
 
 #ifdef HGLEDON_MAIN
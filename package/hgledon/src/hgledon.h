@@ -1,6 +1,8 @@
 #ifndef HGLEDON_H
 #define HGLEDON_H
 
+#include <stddef.h>
+
 typedef struct
 {
     int power[2];
@@ -8,14 +10,101 @@ typedef struct
     int ir;
 } GPIO_PINS;
 
+#define PIN_CACHE "/var/run/hgledon.pins"
+
+// A GPIO line named the way the kernel does: owning chip label + offset
+typedef struct
+{
+    const char *chip;
+    int offset;
+} GPIO_LINE_REF;
+
+// One board/kernel layout. kernel_minor -1 matches kernel_major and anything newer;
+// the legacy numbers are used when the chips can't be found under /sys/class/gpio.
+typedef struct
+{
+    const char *name;
+    int kernel_major;
+    int kernel_minor;
+    GPIO_LINE_REF power[2];
+    GPIO_LINE_REF lan[2];
+    GPIO_LINE_REF ir;
+    GPIO_PINS legacy;
+} BOARD_PROFILE;
+
+typedef struct
+{
+    int pin;
+    int fd;
+    int value;
+} GPIO_HANDLE;
+
+typedef struct
+{
+    int pins[2];
+    int count;
+    int fd;
+    int values;
+} GPIO_LINES;
+
+// Both pins of a bicolor LED, resolved once so they can be written from another thread
+typedef struct
+{
+    GPIO_LINES *lines;
+    GPIO_HANDLE *handles[2];
+} GPIO_PAIR;
+
+typedef struct
+{
+    char name[64];
+    int brightness_fd;
+    int interval_fd;
+    int max_brightness;
+    int interval;
+} LED_CLASS;
+
+// Value writes actually issued vs skipped because the shadow already matched
+typedef struct
+{
+    unsigned long issued;
+    unsigned long elided;
+} GPIO_COUNTERS;
+
+typedef enum
+{
+    GPIO_BACKEND_SYSFS,
+    GPIO_BACKEND_CDEV,
+    GPIO_BACKEND_AUTO
+} gpio_backend_t;
+
+const BOARD_PROFILE *find_profile(int major, int minor);
 GPIO_PINS get_pins(int major, int minor);
+int resolve_pins(const BOARD_PROFILE *profile, GPIO_PINS *pins);
 void export_gpio(int pin);
+GPIO_HANDLE *gpio_open(int pin);
+void gpio_close_all(void);
+void gpio_set_backend(gpio_backend_t backend);
+const GPIO_COUNTERS *gpio_counters(void);
+GPIO_LINES *gpio_request_lines(const int *pins, int count);
+GPIO_LINES *gpio_find_lines(int pin, int count);
+int gpio_set_lines(GPIO_LINES *lines, unsigned int values);
+int gpio_pair_open(int pin_on, int pin_off, GPIO_PAIR *pair);
+int gpio_pair_write(const GPIO_PAIR *pair, unsigned int values);
+void gpio_pair_release(GPIO_PAIR *pair);
 void set_gpio_direction(int pin, const char *direction);
 void set_gpio_value(int pin, int value);
 void lp_control(const char *act, int pin_on, int pin_off);
 void ir_control(const char *ir_action, int pin_ir);
 void hgl_exec(const char *command, const char *action, GPIO_PINS pins);
 GPIO_PINS init_gpio(char *kernel_version);
+const char *hgl_root(void);
+int hgl_path(char *buf, size_t size, const char *fmt, ...);
+int ledcls_open(const char *name, LED_CLASS *led);
+void ledcls_close(LED_CLASS *led);
+int ledcls_set_trigger(LED_CLASS *led, const char *trigger);
+int ledcls_set_brightness(LED_CLASS *led, int value);
+int ledcls_netdev(LED_CLASS *led, const char *ifname, int interval_ms);
+int ledcls_set_interval(LED_CLASS *led, int interval_ms);
 void usage(GPIO_PINS pins, const char *kernel_version);
 
 #endif
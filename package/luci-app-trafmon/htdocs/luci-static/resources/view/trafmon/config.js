@@ -14,31 +14,29 @@ var callInitAction = rpc.declare({
   expect: { result: false },
 });
 
+// One exec: the CLI collects every binding from the daemons' control sockets
 function listRunningInstances() {
   return fs
-    .list("/var/run")
-    .then((entries) => {
+    .exec("/usr/sbin/trafmon", ["status"])
+    .then((res) => {
       var out = [];
-      for (var i = 0; i < entries.length; i++) {
-        var e = entries[i];
-        if (!e || !e.name || e.type !== "file") continue;
-        if (!e.name.match(/^trafmon_.+\.iface$/)) continue;
+      var lines = String(res.stdout || "").split("\n");
+      for (var i = 0; i < lines.length; i++) {
+        var m = lines[i].match(
+          /PID: (\d+)\), interface: (\S+), LED: (\S+)/
+        );
+        if (m) {
+          out.push({ pid: m[1], iface: m[2], led: m[3], rx: "?", tx: "?" });
+          continue;
+        }
 
-        out.push(e.name);
+        var r = lines[i].match(/RX: (\d+) KB\/s, TX: (\d+) KB\/s/);
+        if (r && out.length) {
+          out[out.length - 1].rx = r[1] + " KB/s";
+          out[out.length - 1].tx = r[2] + " KB/s";
+        }
       }
-      return Promise.all(
-        out.map((name) =>
-          fs
-            .readfile("/var/run/" + name)
-            .then((txt) => {
-              var m = String(txt || "")
-                .trim()
-                .split(/\s+/);
-              return { file: name, iface: m[0] || "?", led: m[1] || "?" };
-            })
-            .catch(() => ({ file: name, iface: "?", led: "?" }))
-        )
-      );
+      return out;
     })
     .catch(() => []);
 }
@@ -59,7 +57,7 @@ return view.extend({
       "trafmon",
       _("TrafMon"),
       _(
-        "LED traffic monitor daemon. Configure instances here; service will be restarted on Save & Apply."
+        "LED traffic monitor daemon. Configure instances here; Save & Apply reloads the running daemon in place."
       )
     );
 
@@ -74,9 +72,26 @@ return view.extend({
     o.default = o.disabled;
     o.rmempty = false;
 
-    o = s.option(form.ListValue, "ifname", _("Interface"));
+    o = s.option(
+      form.ListValue,
+      "source",
+      _("Source"),
+      _("Softnet follows the packet-processing pressure of the busiest CPU core, conntrack the fill level of the connection-tracking table.")
+    );
+    o.value("link", _("Interfaces"));
+    o.value("softnet", _("CPU softnet"));
+    o.value("conntrack", _("Conntrack table"));
+    o.default = "link";
+
+    o = s.option(
+      form.DynamicList,
+      "ifname",
+      _("Interfaces"),
+      _("More than one entry, or a glob like wwan* or pppoe-*, sums their traffic onto one LED.")
+    );
     o.datatype = "string";
     o.rmempty = false;
+    o.depends("source", "link");
 
     // Populate interfaces dynamically
     var devs = network.getDevices() || [];
@@ -85,6 +100,18 @@ return view.extend({
       if (d && d.getName) o.value(d.getName());
     });
 
+    o = s.option(
+      form.DynamicList,
+      "master",
+      _("Members of"),
+      _("Also sum every port of these bridges or bonds.")
+    );
+    o.datatype = "string";
+    o.depends("source", "link");
+    devs.forEach(function (d) {
+      if (d && d.getType && (d.getType() == "bridge" || d.getType() == "bond")) o.value(d.getName());
+    });
+
     // LEDs
     o = s.option(form.ListValue, "led", _("LED"));
     o.value("lan", "lan");
@@ -92,6 +119,122 @@ return view.extend({
     o.default = "lan";
     o.rmempty = false;
 
+    o = s.option(
+      form.Value,
+      "smoothing",
+      _("Smoothing (ms)"),
+      _("Time constant of the throughput average. 0 reacts to every sample.")
+    );
+    o.datatype = "uinteger";
+    o.placeholder = "300";
+
+    o = s.option(
+      form.ListValue,
+      "curve",
+      _("Blink curve"),
+      _("How link utilisation maps onto the blink speed.")
+    );
+    o.value("log", _("Logarithmic"));
+    o.value("linear", _("Linear"));
+    o.value("stepped", _("Stepped"));
+    o.default = "log";
+
+    o = s.option(
+      form.ListValue,
+      "mode",
+      _("Display"),
+      _("Brightness uses software PWM and falls back to blinking on slow GPIOs.")
+    );
+    o.value("blink", _("Blink speed"));
+    o.value("pwm", _("Brightness"));
+    o.default = "blink";
+
+    o = s.option(
+      form.Value,
+      "ceiling",
+      _("Ceiling (Mbit/s)"),
+      _("Throughput that blinks at full speed. Defaults to the negotiated link speed.")
+    );
+    o.datatype = "uinteger";
+    o.placeholder = _("auto");
+
+    o = s.option(
+      form.Value,
+      "overload",
+      _("Overload warning (drops/s)"),
+      _("Show the warning color while dropped and missed packets exceed this rate. Empty disables.")
+    );
+    o.datatype = "uinteger";
+
+    o = s.option(
+      form.Flag,
+      "queues",
+      _("Queue balance"),
+      _("Report how evenly a multi-queue NIC spreads traffic over its queues.")
+    );
+    o.default = o.disabled;
+    o.depends("source", "link");
+
+    o = s.option(
+      form.Value,
+      "imbalance",
+      _("Imbalance warning (%)"),
+      _("Blink green/red instead of green while a queue carries this much more than its share.")
+    );
+    o.datatype = "range(1,100)";
+    o.depends("queues", "1");
+
+    o = s.option(
+      form.Flag,
+      "offload",
+      _("Kernel offload"),
+      _("Blink through the kernel netdev LED trigger instead of driving the GPIOs.")
+    );
+    o.default = o.disabled;
+
+    o = s.option(form.Value, "sysfs_led", _("LED device"), _("Name under /sys/class/leds."));
+    o.depends("offload", "1");
+
+    o = s.option(
+      form.Value,
+      "sysfs_led_off",
+      _("Second color LED"),
+      _("Optional. Kept dark while offloaded.")
+    );
+    o.depends("offload", "1");
+
+    var g = m.section(form.NamedSection, "globals", "globals", _("Logging"));
+    g.addremove = true;
+
+    o = g.option(form.ListValue, "log_level", _("Log level"));
+    o.value("error", _("Error"));
+    o.value("warning", _("Warning"));
+    o.value("notice", _("Notice"));
+    o.value("info", _("Info"));
+    o.value("debug", _("Debug"));
+    o.default = "info";
+
+    o = g.option(
+      form.Value,
+      "log_rate",
+      _("Rate limit (messages/s)"),
+      _("Per message class; 0 disables the limit.")
+    );
+    o.datatype = "uinteger";
+    o.placeholder = "5";
+
+    o = g.option(form.Value, "log_burst", _("Burst"));
+    o.datatype = "uinteger";
+    o.placeholder = "20";
+
+    o = g.option(
+      form.Flag,
+      "log_ring",
+      _("Debug ring"),
+      _("Keep recent debug events in memory for 'trafmon log'.")
+    );
+    o.default = o.disabled;
+
     /* Running instances panel */
     var stat = m.section(form.TypedSection, "_runtime", _("Running instances"));
     stat.anonymous = true;
@@ -102,9 +245,11 @@ return view.extend({
         E(
           "tr",
           {},
-          E("th", {}, _("Lock File")),
           E("th", {}, _("Interface")),
-          E("th", {}, _("LED"))
+          E("th", {}, _("LED")),
+          E("th", {}, _("RX")),
+          E("th", {}, _("TX")),
+          E("th", {}, _("PID"))
         )
       );
 
@@ -113,7 +258,7 @@ return view.extend({
           E(
             "tr",
             {},
-            E("td", { colspan: 3 }, _("No running trafmon instances."))
+            E("td", { colspan: 5 }, _("No running trafmon instances."))
           )
         );
       } else {
@@ -122,9 +267,11 @@ return view.extend({
             E(
               "tr",
               {},
-              E("td", {}, item.file),
               E("td", {}, item.iface),
-              E("td", {}, item.led)
+              E("td", {}, item.led),
+              E("td", {}, item.rx),
+              E("td", {}, item.tx),
+              E("td", {}, item.pid)
             )
           );
         });
@@ -133,7 +280,7 @@ return view.extend({
       return E("div", { class: "cbi-section" }, table);
     };
 
-    /* Save & Apply → restart service */
+    /* Save & Apply → reload service */
     m.handleSaveApply = function (ev, mode) {
       return this.save()
         .then(
@@ -142,11 +289,11 @@ return view.extend({
           }, this)
         )
         .then(function () {
-          // restart daemon after apply
-          return callInitAction("trafmon", "restart");
+          // the daemon applies the new config without dropping its LEDs or counters
+          return callInitAction("trafmon", "reload");
         })
         .then(function () {
-          ui.addNotification(null, E("p", {}, _("TrafMon service restarted.")));
+          ui.addNotification(null, E("p", {}, _("TrafMon configuration reloaded.")));
           // Refresh page to re-pull running instances
           window.location.reload();
         })
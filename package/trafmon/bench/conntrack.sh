@@ -0,0 +1,56 @@
+#!/bin/sh
+# Fill the conntrack table of a throwaway network namespace and watch a
+# conntrack instance follow it. Needs root, ip and nft.
+#
+#   conntrack.sh [flows]
+
+cd "$(dirname "$0")" || exit 1
+
+FLOWS="${1:-150}"
+NS=trafmon-ct
+ROOT="$(mktemp -d /dev/shm/trafmon-ct.XXXXXX)" || exit 1
+CONF="$(pwd)/conntrack.conf"
+
+./fakeroot.sh "$ROOT"
+# Per-namespace files, resolved in the namespace of whoever opens them
+ln -s /proc/sys/net "$ROOT/proc/sys/net"
+ln -s /proc/self/net "$ROOT/proc/net"
+
+# A ceiling of 200 entries stands in for nf_conntrack_max, which only the
+# initial namespace can lower
+cat > "$CONF" <<CONF
+config instance 'nat'
+	option enabled '1'
+	option source 'conntrack'
+	option led 'lan'
+	option ceiling '200'
+CONF
+
+ip netns add "$NS" || exit 1
+ip netns exec "$NS" ip link set lo up
+
+# Connections are only tracked once a rule needs them
+ip netns exec "$NS" nft -f - <<NFT
+table inet trafmon_ct {
+	chain out {
+		type filter hook output priority 0;
+		ct state new counter
+	}
+}
+NFT
+
+HGLEDON_ROOT="$ROOT" ip netns exec "$NS" ./trafmon daemon "$CONF" &
+pid=$!
+sleep 3
+
+# Every ping gets its own ICMP id, hence its own entry for 30 s
+ip netns exec "$NS" sh -c "i=0; while [ \$i -lt $FLOWS ]; do ping -c 1 -W 1 127.0.0.1 >/dev/null; i=\$((i + 1)); done"
+sleep 3
+
+HGLEDON_ROOT="$ROOT" ip netns exec "$NS" ./trafmon status
+ip netns exec "$NS" cat /proc/sys/net/netfilter/nf_conntrack_count
+
+kill "$pid"
+wait "$pid" 2>/dev/null
+ip netns del "$NS"
+rm -rf "$ROOT" "$CONF"
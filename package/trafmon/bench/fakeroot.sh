@@ -0,0 +1,36 @@
+#!/bin/sh
+# Build a minimal sysfs/procfs tree for trafmon under $1 (HGLEDON_ROOT)
+
+ROOT="${1:?usage: fakeroot.sh <root> [ifname]}"
+IFNAME="${2:-bench0}"
+
+rm -rf "$ROOT"
+mkdir -p "$ROOT/proc/sys/kernel" "$ROOT/sys/class/gpio" "$ROOT/sys/class/net/$IFNAME/statistics" "$ROOT/var/run"
+
+echo "6.6.0-bench" > "$ROOT/proc/sys/kernel/osrelease"
+
+# The two gpiochips of the 6.x kernels, so pins are found by label + offset
+mkchip() {
+	mkdir -p "$ROOT/sys/class/gpio/gpiochip$1"
+	echo "$1" > "$ROOT/sys/class/gpio/gpiochip$1/base"
+	echo "$2" > "$ROOT/sys/class/gpio/gpiochip$1/label"
+	echo "$3" > "$ROOT/sys/class/gpio/gpiochip$1/ngpio"
+}
+mkchip 512 aobus-banks 11
+mkchip 523 periphs-banks 100
+
+# Resulting pins: power, lan and ir
+touch "$ROOT/sys/class/gpio/export" "$ROOT/sys/class/gpio/unexport"
+for pin in 547 548 521 517 580; do
+	mkdir -p "$ROOT/sys/class/gpio/gpio$pin"
+	echo 0 > "$ROOT/sys/class/gpio/gpio$pin/value"
+	echo in > "$ROOT/sys/class/gpio/gpio$pin/direction"
+done
+
+NET="$ROOT/sys/class/net/$IFNAME"
+echo 1 > "$NET/carrier"
+echo up > "$NET/operstate"
+echo 1000 > "$NET/speed"
+for f in rx_bytes tx_bytes rx_packets tx_packets rx_dropped tx_dropped rx_errors tx_errors; do
+	echo 0 > "$NET/statistics/$f"
+done
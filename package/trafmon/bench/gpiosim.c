@@ -0,0 +1,65 @@
+// Drive both lines of an LED pair through the chardev backend and check
+// what gpio-sim saw on each. Run by gpiosim.sh, which creates the chips
+// and a root prefix that links them in.
+//
+//   gpiosim <pin0> <pin1> <sim_value0> <sim_value1>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/hgledon.h"
+
+static int read_value(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    int v = -1;
+
+    if (!f)
+        return -1;
+    if (fscanf(f, "%d", &v) != 1)
+        v = -1;
+    fclose(f);
+    return v;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 5)
+    {
+        fprintf(stderr, "usage: %s <pin0> <pin1> <sim_value0> <sim_value1>\n", argv[0]);
+        return 1;
+    }
+
+    int pins[2] = {atoi(argv[1]), atoi(argv[2])};
+    int failed = 0;
+
+    gpio_set_backend(GPIO_BACKEND_CDEV);
+    GPIO_LINES *l = gpio_request_lines(pins, 2);
+    if (!l)
+    {
+        fprintf(stderr, "pins %d,%d: no line request\n", pins[0], pins[1]);
+        return 1;
+    }
+
+    // Every combination, then back, so each line is seen switching both ways
+    static const unsigned int seq[] = {1, 3, 2, 0, 2, 3, 1, 0};
+
+    for (size_t i = 0; i < sizeof(seq) / sizeof(seq[0]); i++)
+    {
+        if (gpio_set_lines(l, seq[i]) < 0)
+        {
+            fprintf(stderr, "pins %d,%d: SET_VALUES %u failed\n", pins[0], pins[1], seq[i]);
+            return 1;
+        }
+
+        int v0 = read_value(argv[3]);
+        int v1 = read_value(argv[4]);
+        int ok = v0 == (int)(seq[i] & 1) && v1 == (int)(seq[i] >> 1);
+
+        printf("pins %d,%d set %u%u: sim %d%d %s\n", pins[0], pins[1], seq[i] & 1, seq[i] >> 1, v0, v1,
+               ok ? "ok" : "FAIL");
+        failed |= !ok;
+    }
+
+    return failed;
+}
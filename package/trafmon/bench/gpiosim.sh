@@ -0,0 +1,55 @@
+#!/bin/sh
+# Check the gpiochip v2 line backend against gpio-sim: two simulated chips
+# named like the board's, linked into a fake root, and SET_VALUES on both
+# lines of each LED pair read back from the simulator. Needs root, configfs
+# and the gpio-sim module.
+#
+#   gpiosim.sh
+
+cd "$(dirname "$0")" || exit 1
+
+ROOT="$(mktemp -d /dev/shm/trafmon-gpiosim.XXXXXX)" || exit 1
+CFG=/sys/kernel/config/gpio-sim/hgledon-bench
+
+modprobe gpio-sim 2>/dev/null
+mountpoint -q /sys/kernel/config || mount -t configfs none /sys/kernel/config
+if [ ! -d /sys/kernel/config/gpio-sim ]; then
+	echo "gpio-sim is not available" >&2
+	exit 1
+fi
+
+cleanup() {
+	echo 0 > "$CFG/live" 2>/dev/null
+	rmdir "$CFG/bank0" "$CFG/bank1" "$CFG" 2>/dev/null
+	rm -rf "$ROOT"
+}
+trap cleanup EXIT
+
+# The chips of the 6.x kernels, as fakeroot.sh lays them out: aobus-banks
+# at 512, periphs-banks at 523
+mkdir -p "$CFG/bank0" "$CFG/bank1"
+echo aobus-banks > "$CFG/bank0/label"
+echo 11 > "$CFG/bank0/num_lines"
+echo periphs-banks > "$CFG/bank1/label"
+echo 100 > "$CFG/bank1/num_lines"
+echo 1 > "$CFG/live" || exit 1
+
+DEV="$(cat "$CFG/dev_name")"
+AOBUS="$(cat "$CFG/bank0/chip_name")"
+PERIPHS="$(cat "$CFG/bank1/chip_name")"
+SIM="/sys/devices/platform/$DEV"
+
+./fakeroot.sh "$ROOT"
+mkdir -p "$ROOT/dev"
+ln -s "/dev/$AOBUS" "$ROOT/dev/$AOBUS"
+ln -s "/dev/$PERIPHS" "$ROOT/dev/$PERIPHS"
+
+export HGLEDON_ROOT="$ROOT"
+status=0
+
+# power: periphs-banks 24 and 25; lan: aobus-banks 9 and 5
+./gpiosim 547 548 "$SIM/$PERIPHS/sim_gpio24/value" "$SIM/$PERIPHS/sim_gpio25/value" || status=1
+./gpiosim 521 517 "$SIM/$AOBUS/sim_gpio9/value" "$SIM/$AOBUS/sim_gpio5/value" || status=1
+
+[ $status -eq 0 ] && echo "gpio-sim: all line values matched"
+exit $status
@@ -0,0 +1,80 @@
+// Replay RTM_NEWLINK/RTM_DELLINK messages shaped like the kernel's through
+// rtnl_parse_link and check what the daemon would see. Covers a port
+// leaving a bridge, which the kernel announces with an extra AF_BRIDGE
+// DELLINK while the link itself stays up.
+//
+//   rtnlcheck
+
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+
+#include "../src/rtnl.h"
+
+typedef struct
+{
+    struct nlmsghdr nlh;
+    struct ifinfomsg ifi;
+    char attrs[256];
+} LINK_MSG;
+
+static void add_attr(LINK_MSG *m, int type, const void *data, int len)
+{
+    struct rtattr *rta = (struct rtattr *)((char *)m + NLMSG_ALIGN(m->nlh.nlmsg_len));
+
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(len);
+    memcpy(RTA_DATA(rta), data, len);
+    m->nlh.nlmsg_len = NLMSG_ALIGN(m->nlh.nlmsg_len) + RTA_ALIGN(rta->rta_len);
+}
+
+static void build(LINK_MSG *m, int type, int family, int ifindex, const char *ifname, int master)
+{
+    memset(m, 0, sizeof(*m));
+    m->nlh.nlmsg_len = NLMSG_LENGTH(sizeof(m->ifi));
+    m->nlh.nlmsg_type = type;
+    m->ifi.ifi_family = family;
+    m->ifi.ifi_index = ifindex;
+    m->ifi.ifi_flags = IFF_UP | IFF_RUNNING | IFF_LOWER_UP;
+    add_attr(m, IFLA_IFNAME, ifname, strlen(ifname) + 1);
+    if (master)
+        add_attr(m, IFLA_MASTER, &master, sizeof(uint32_t));
+}
+
+static int check(const char *what, int ok)
+{
+    printf("%-44s %s\n", what, ok ? "ok" : "FAIL");
+    return !ok;
+}
+
+int main(void)
+{
+    LINK_MSG m;
+    LINK_STATS st;
+    int failed = 0;
+
+    // eth1 (3) enslaved to br-lan (5)
+    build(&m, RTM_NEWLINK, AF_UNSPEC, 3, "eth1", 5);
+    failed |= check("port NEWLINK is a link update",
+                    rtnl_parse_link(&m.nlh, &st) == 0 && !st.removed && st.ifindex == 3 && st.master == 5);
+
+    // br-lan reconfigured: the bridge drops its port entry, eth1 stays
+    build(&m, RTM_DELLINK, AF_BRIDGE, 3, "eth1", 5);
+    failed |= check("bridge-port DELLINK (AF_BRIDGE) is ignored", rtnl_parse_link(&m.nlh, &st) < 0);
+
+    build(&m, RTM_NEWLINK, AF_BRIDGE, 3, "eth1", 5);
+    failed |= check("bridge-port NEWLINK (AF_BRIDGE) is ignored", rtnl_parse_link(&m.nlh, &st) < 0);
+
+    // The port left: a plain NEWLINK without IFLA_MASTER
+    build(&m, RTM_NEWLINK, AF_UNSPEC, 3, "eth1", 0);
+    failed |= check("NEWLINK after leaving has no master",
+                    rtnl_parse_link(&m.nlh, &st) == 0 && !st.removed && st.master == 0 && st.carrier);
+
+    build(&m, RTM_DELLINK, AF_UNSPEC, 3, "eth1", 0);
+    failed |= check("link DELLINK (AF_UNSPEC) removes the link",
+                    rtnl_parse_link(&m.nlh, &st) == 0 && st.removed && st.ifindex == 3);
+
+    return failed;
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Run trafmon against a fake tree under each traffic profile and report its cost.
+# The tree lives on tmpfs, so the counter writes of trafgen stay off the disk.
+#
+#   run.sh [seconds] [profile...]
+
+cd "$(dirname "$0")" || exit 1
+
+SECS="${1:-20}"
+[ $# -gt 0 ] && shift
+PROFILES="${*:-idle steady bursty flap}"
+ROOT="$(mktemp -d /dev/shm/trafmon-bench.XXXXXX)" || exit 1
+CONF="$(pwd)/bench.conf"
+IFNAME=bench0
+# Past IDLE_BACKOFF_AFTER (10 s) with the LED steady, so idle measures the backed-off tick
+IDLE_SETTLE=12
+
+cat > "$CONF" <<CONF
+config instance 'bench'
+	option enabled '1'
+	option ifname '$IFNAME'
+	option led 'lan'
+CONF
+
+printf "%-8s %6s %8s %6s %10s %12s %12s %10s\n" \
+	profile secs cpu_ms cpu% wakeups/s rw_calls/s calls/wakeup gpio_wr/s
+
+for profile in $PROFILES; do
+	./fakeroot.sh "$ROOT" "$IFNAME"
+
+	HGLEDON_ROOT="$ROOT" ./trafmon daemon "$CONF" &
+	pid=$!
+	if [ "$profile" = idle ]; then
+		sleep "$IDLE_SETTLE"
+	else
+		sleep 1
+	fi
+
+	./trafgen "$ROOT" "$IFNAME" "$profile" "$SECS" "$pid"
+
+	kill "$pid"
+	wait "$pid" 2>/dev/null
+done
+
+rm -rf "$ROOT" "$CONF"
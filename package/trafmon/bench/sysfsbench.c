@@ -0,0 +1,117 @@
+// Cost of one sysfs sample tick of a binding: rx_bytes, tx_bytes and
+// carrier, read the way trafmon used to (directory scan plus
+// fopen/fscanf/fclose per file) and through netattr (pread on fds kept
+// open). Honours HGLEDON_ROOT like the daemon.
+//
+//   sysfsbench <ifname> [ticks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <stdint.h>
+
+#include "../src/hgledon.h"
+#include "../src/netattr.h"
+
+#define DEFAULT_TICKS 100000
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint64_t stdio_counter(const char *ifname, const char *attr)
+{
+    char path[256];
+    unsigned long long v = 0;
+
+    hgl_path(path, sizeof(path), "/sys/class/net/%s/%s", ifname, attr);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+    if (fscanf(f, "%llu", &v) != 1)
+        v = 0;
+    fclose(f);
+    return v;
+}
+
+static int stdio_carrier(const char *ifname)
+{
+    char path[256];
+    struct dirent *entry;
+    int found = 0;
+
+    hgl_path(path, sizeof(path), "/sys/class/net");
+    DIR *dir = opendir(path);
+    if (!dir)
+        return 0;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ifname) == 0)
+        {
+            found = 1;
+            break;
+        }
+    }
+    closedir(dir);
+
+    return found && stdio_counter(ifname, "carrier") == 1;
+}
+
+static uint64_t stdio_tick(const char *ifname)
+{
+    return stdio_counter(ifname, "statistics/rx_bytes") + stdio_counter(ifname, "statistics/tx_bytes") +
+           stdio_carrier(ifname);
+}
+
+static uint64_t pread_tick(NET_ATTRS *na)
+{
+    uint64_t rx = 0, tx = 0, carrier = 0;
+
+    netattr_read(na, NET_RX_BYTES, &rx);
+    netattr_read(na, NET_TX_BYTES, &tx);
+    if (netattr_read(na, NET_CARRIER, &carrier) < 0)
+        carrier = 0;
+    return rx + tx + (carrier == 1);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <ifname> [ticks]\n", argv[0]);
+        return 1;
+    }
+
+    const char *ifname = argv[1];
+    long ticks = argc > 2 ? atol(argv[2]) : DEFAULT_TICKS;
+    NET_ATTRS na;
+    uint64_t sink = 0;
+
+    if (ticks <= 0)
+        ticks = DEFAULT_TICKS;
+    netattr_init(&na, ifname);
+
+    long long start = now_ns();
+    for (long i = 0; i < ticks; i++)
+        sink += stdio_tick(ifname);
+    long long stdio_ns = now_ns() - start;
+
+    start = now_ns();
+    for (long i = 0; i < ticks; i++)
+        sink += pread_tick(&na);
+    long long pread_ns = now_ns() - start;
+
+    netattr_close(&na);
+
+    printf("%-6s %10s %10s\n", "path", "ns/tick", "ticks");
+    printf("%-6s %10lld %10ld\n", "stdio", stdio_ns / ticks, ticks);
+    printf("%-6s %10lld %10ld\n", "pread", pread_ns / ticks, ticks);
+    printf("speedup %.1fx (checksum %llu)\n", pread_ns ? (double)stdio_ns / pread_ns : 0.0,
+           (unsigned long long)sink);
+    return 0;
+}
@@ -0,0 +1,245 @@
+// Drive the fake counters of one interface with a traffic profile and
+// measure the trafmon process watching them.
+//
+//   trafgen <root> <ifname> <profile> <seconds> <pid>
+//
+// profile: idle | steady | bursty | flap
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <dirent.h>
+#include <stdint.h>
+
+#include <sys/inotify.h>
+
+#define STEP_MS 100
+#define STEADY_RATE (2 * 1024 * 1024) // bytes/s
+#define BURST_RATE (50 * 1024 * 1024)
+#define BURST_MS 300
+#define BURST_EVERY_MS 2000
+#define FLAP_MS 5000
+#define PKT_SIZE 1000
+
+typedef struct
+{
+    double cpu_ms;
+    unsigned long wakeups;
+    unsigned long rw_calls; // syscr + syscw: read/write-class syscalls only
+} PROC_SAMPLE;
+
+static int open_attr(const char *root, const char *ifname, const char *attr)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/sys/class/net/%s/%s", root, ifname, attr);
+
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        perror(path);
+    return fd;
+}
+
+static void write_u64(int fd, uint64_t v)
+{
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%llu\n", (unsigned long long)v);
+
+    // Counters only grow, so rewriting in place never leaves stale digits
+    pwrite(fd, buf, n, 0);
+}
+
+static long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static int read_proc(int pid, PROC_SAMPLE *s)
+{
+    char path[64], buf[1024];
+    FILE *f;
+
+    memset(s, 0, sizeof(*s));
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if (!(f = fopen(path, "r")))
+        return -1;
+    if (fgets(buf, sizeof(buf), f))
+    {
+        unsigned long utime, stime;
+        char *p = strrchr(buf, ')');
+        if (p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) == 2)
+            s->cpu_ms = (utime + stime) * 1000.0 / sysconf(_SC_CLK_TCK);
+    }
+    fclose(f);
+
+    // Every sleep in epoll_wait ends in a voluntary context switch
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    if ((f = fopen(path, "r")))
+    {
+        while (fgets(buf, sizeof(buf), f))
+            sscanf(buf, "voluntary_ctxt_switches: %lu", &s->wakeups);
+        fclose(f);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/io", pid);
+    if ((f = fopen(path, "r")))
+    {
+        unsigned long v;
+        while (fgets(buf, sizeof(buf), f))
+        {
+            if (sscanf(buf, "syscr: %lu", &v) == 1 || sscanf(buf, "syscw: %lu", &v) == 1)
+                s->rw_calls += v;
+        }
+        fclose(f);
+    }
+    return 0;
+}
+
+// Count writes to every exported GPIO value file
+static int watch_gpios(const char *root)
+{
+    char path[512];
+    struct dirent *e;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    snprintf(path, sizeof(path), "%s/sys/class/gpio", root);
+    DIR *d = opendir(path);
+    if (fd < 0 || !d)
+        return fd;
+
+    while ((e = readdir(d)) != NULL)
+    {
+        if (strncmp(e->d_name, "gpio", 4) != 0 || strncmp(e->d_name, "gpiochip", 8) == 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/sys/class/gpio/%s/value", root, e->d_name);
+        inotify_add_watch(fd, path, IN_MODIFY);
+    }
+    closedir(d);
+    return fd;
+}
+
+static unsigned long drain_gpio_events(int fd)
+{
+    char buf[4096] __attribute__((aligned(8)));
+    unsigned long n = 0;
+    ssize_t len;
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0)
+    {
+        for (char *p = buf; p < buf + len;)
+        {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            n++;
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+    return n;
+}
+
+// Bytes/s the profile wants at time t (ms since start); may drop carrier
+static uint64_t profile_rate(const char *profile, long t, int *carrier)
+{
+    *carrier = 1;
+
+    if (strcmp(profile, "steady") == 0)
+        return STEADY_RATE;
+    if (strcmp(profile, "bursty") == 0)
+        return t % BURST_EVERY_MS < BURST_MS ? BURST_RATE : 0;
+    if (strcmp(profile, "flap") == 0)
+    {
+        *carrier = (t / FLAP_MS) % 2 == 0;
+        return *carrier ? STEADY_RATE : 0;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 6)
+    {
+        fprintf(stderr, "usage: %s <root> <ifname> <idle|steady|bursty|flap> <seconds> <pid>\n", argv[0]);
+        return 1;
+    }
+
+    const char *root = argv[1];
+    const char *ifname = argv[2];
+    const char *profile = argv[3];
+    int seconds = atoi(argv[4]);
+    int pid = atoi(argv[5]);
+
+    int rx_fd = open_attr(root, ifname, "statistics/rx_bytes");
+    int tx_fd = open_attr(root, ifname, "statistics/tx_bytes");
+    int rxp_fd = open_attr(root, ifname, "statistics/rx_packets");
+    int txp_fd = open_attr(root, ifname, "statistics/tx_packets");
+    int carrier_fd = open_attr(root, ifname, "carrier");
+    int in_fd = watch_gpios(root);
+
+    if (rx_fd < 0 || tx_fd < 0 || rxp_fd < 0 || txp_fd < 0 || carrier_fd < 0)
+        return 1;
+
+    PROC_SAMPLE start, end;
+    if (read_proc(pid, &start) < 0)
+    {
+        fprintf(stderr, "trafmon (pid %d) is not running\n", pid);
+        return 1;
+    }
+
+    uint64_t rx = 0, tx = 0;
+    unsigned long gpio_writes = 0;
+    int carrier = 1;
+    long t0 = now_ms();
+    long next = t0;
+
+    while (now_ms() - t0 < seconds * 1000L)
+    {
+        int c;
+        uint64_t bytes = profile_rate(profile, next - t0, &c) * STEP_MS / 1000;
+
+        // Two thirds download, one third upload
+        rx += bytes * 2 / 3;
+        tx += bytes / 3;
+        write_u64(rx_fd, rx);
+        write_u64(tx_fd, tx);
+        write_u64(rxp_fd, rx / PKT_SIZE);
+        write_u64(txp_fd, tx / PKT_SIZE);
+        if (c != carrier)
+        {
+            pwrite(carrier_fd, c ? "1\n" : "0\n", 2, 0);
+            carrier = c;
+        }
+
+        next += STEP_MS;
+        long wait = next - now_ms();
+        struct pollfd pfd = {.fd = in_fd, .events = POLLIN};
+        while (wait > 0)
+        {
+            if (poll(&pfd, in_fd >= 0, wait) > 0)
+                gpio_writes += drain_gpio_events(in_fd);
+            wait = next - now_ms();
+        }
+    }
+    if (in_fd >= 0)
+        gpio_writes += drain_gpio_events(in_fd);
+
+    if (read_proc(pid, &end) < 0)
+    {
+        fprintf(stderr, "trafmon (pid %d) exited during the run\n", pid);
+        return 1;
+    }
+
+    double secs = (now_ms() - t0) / 1000.0;
+    unsigned long wakeups = end.wakeups - start.wakeups;
+    unsigned long rw_calls = end.rw_calls - start.rw_calls;
+
+    printf("%-8s %6.1f %8.1f %6.2f %10.1f %12.1f %12.2f %10.1f\n", profile, secs,
+           end.cpu_ms - start.cpu_ms, (end.cpu_ms - start.cpu_ms) / (secs * 10),
+           wakeups / secs, rw_calls / secs, wakeups ? (double)rw_calls / wakeups : 0.0,
+           gpio_writes / secs);
+    return 0;
+}
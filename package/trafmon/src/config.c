@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "config.h"
+
+#define MAX_LINE 256
+
+// Split one UCI token off *p, honouring single and double quotes
+static char *next_token(char **p)
+{
+    char *s = *p;
+
+    while (isspace((unsigned char)*s))
+        s++;
+    if (!*s || *s == '#')
+        return NULL;
+
+    char *tok = s;
+    char *out = s;
+    char quote = 0;
+
+    for (; *s; s++)
+    {
+        if (quote)
+        {
+            if (*s == quote)
+                quote = 0;
+            else
+                *out++ = *s;
+        }
+        else if (*s == '\'' || *s == '"')
+        {
+            quote = *s;
+        }
+        else if (isspace((unsigned char)*s))
+        {
+            s++;
+            break;
+        }
+        else
+        {
+            *out++ = *s;
+        }
+    }
+
+    *out = '\0';
+    *p = s;
+    return tok;
+}
+
+static int parse_bool(const char *v)
+{
+    return strcmp(v, "1") == 0 || strcmp(v, "on") == 0 ||
+           strcmp(v, "true") == 0 || strcmp(v, "yes") == 0 ||
+           strcmp(v, "enabled") == 0;
+}
+
+static void set_option(INSTANCE_CONF *ic, const char *key, const char *val)
+{
+    if (strcmp(key, "enabled") == 0)
+        ic->enabled = parse_bool(val);
+    else if (strcmp(key, "ifname") == 0)
+    {
+        // Repeated or list values build a group; the first one names the binding
+        if (!ic->member_count)
+            snprintf(ic->ifname, sizeof(ic->ifname), "%s", val);
+        if (ic->member_count < CONFIG_MAX_LIST)
+            snprintf(ic->members[ic->member_count++], IFNAMSIZ, "%s", val);
+    }
+    else if (strcmp(key, "master") == 0)
+    {
+        if (!ic->ifname[0])
+            snprintf(ic->ifname, sizeof(ic->ifname), "%s", val);
+        if (ic->master_count < CONFIG_MAX_LIST)
+            snprintf(ic->masters[ic->master_count++], IFNAMSIZ, "%s", val);
+    }
+    else if (strcmp(key, "led") == 0)
+        snprintf(ic->led, sizeof(ic->led), "%s", val);
+    else if (strcmp(key, "offload") == 0)
+        ic->offload = parse_bool(val);
+    else if (strcmp(key, "sysfs_led") == 0)
+        snprintf(ic->sysfs_led, sizeof(ic->sysfs_led), "%s", val);
+    else if (strcmp(key, "sysfs_led_off") == 0)
+        snprintf(ic->sysfs_led_off, sizeof(ic->sysfs_led_off), "%s", val);
+    else if (strcmp(key, "smoothing") == 0)
+        ic->smoothing = atoi(val);
+    else if (strcmp(key, "curve") == 0)
+        snprintf(ic->curve, sizeof(ic->curve), "%s", val);
+    else if (strcmp(key, "ceiling") == 0)
+        ic->ceiling = atoi(val);
+    else if (strcmp(key, "mode") == 0)
+        snprintf(ic->mode, sizeof(ic->mode), "%s", val);
+    else if (strcmp(key, "overload") == 0)
+        ic->overload = atoi(val);
+    else if (strcmp(key, "queues") == 0)
+        ic->queues = parse_bool(val);
+    else if (strcmp(key, "imbalance") == 0)
+        ic->imbalance = atoi(val);
+    else if (strcmp(key, "source") == 0)
+        snprintf(ic->source, sizeof(ic->source), "%s", val);
+}
+
+static void set_global(GLOBAL_CONF *g, const char *key, const char *val)
+{
+    if (strcmp(key, "log_level") == 0)
+        snprintf(g->log_level, sizeof(g->log_level), "%s", val);
+    else if (strcmp(key, "log_rate") == 0)
+        g->log_rate = atoi(val);
+    else if (strcmp(key, "log_burst") == 0)
+        g->log_burst = atoi(val);
+    else if (strcmp(key, "log_ring") == 0)
+        g->log_ring = parse_bool(val);
+}
+
+// Read every 'config instance' section, plus 'config globals' when asked;
+// returns the instance count or -1
+int config_load(const char *path, INSTANCE_CONF **out, GLOBAL_CONF *globals)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+
+    INSTANCE_CONF *list = NULL;
+    INSTANCE_CONF *cur = NULL;
+    int count = 0;
+    int anon = 0;
+    int in_globals = 0;
+    char line[MAX_LINE];
+
+    if (globals)
+    {
+        memset(globals, 0, sizeof(*globals));
+        globals->log_rate = -1;
+        globals->log_burst = -1;
+        globals->log_ring = -1;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        char *p = line;
+        char *kw = next_token(&p);
+        if (!kw)
+            continue;
+
+        if (strcmp(kw, "config") == 0)
+        {
+            char *type = next_token(&p);
+            char *name = next_token(&p);
+
+            cur = NULL;
+            in_globals = type && strcmp(type, "globals") == 0;
+            if (!type || strcmp(type, "instance") != 0)
+                continue;
+
+            INSTANCE_CONF *tmp = realloc(list, (count + 1) * sizeof(*list));
+            if (!tmp)
+                break;
+            list = tmp;
+            cur = &list[count++];
+
+            memset(cur, 0, sizeof(*cur));
+            snprintf(cur->led, sizeof(cur->led), "lan");
+            cur->smoothing = -1;
+            if (name)
+                snprintf(cur->name, sizeof(cur->name), "%s", name);
+            else
+                snprintf(cur->name, sizeof(cur->name), "@instance[%d]", anon);
+            anon++;
+        }
+        else if ((cur || in_globals) && (strcmp(kw, "option") == 0 || strcmp(kw, "list") == 0))
+        {
+            char *key = next_token(&p);
+            char *val = next_token(&p);
+
+            if (!key || !val)
+                continue;
+            if (cur)
+                set_option(cur, key, val);
+            else if (globals)
+                set_global(globals, key, val);
+        }
+    }
+
+    fclose(f);
+
+    // Sources other than links follow a kernel table rather than an
+    // interface; their name stands in for the ifname
+    for (int i = 0; i < count; i++)
+    {
+        if (!list[i].source[0] || strcmp(list[i].source, "link") == 0)
+            continue;
+        snprintf(list[i].ifname, sizeof(list[i].ifname), "%s", list[i].source);
+        list[i].member_count = 0;
+        list[i].master_count = 0;
+    }
+
+    *out = list;
+    return count;
+}
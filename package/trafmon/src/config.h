@@ -0,0 +1,42 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <net/if.h>
+
+#define CONFIG_PATH "/etc/config/trafmon"
+#define CONFIG_MAX_LIST 8
+
+typedef struct
+{
+    char name[32];
+    char ifname[IFNAMSIZ]; // first ifname entry, or the first master
+    char members[CONFIG_MAX_LIST][IFNAMSIZ];
+    int member_count;
+    char masters[CONFIG_MAX_LIST][IFNAMSIZ];
+    int master_count;
+    char led[16];
+    int enabled;
+    int offload;
+    char sysfs_led[64];
+    char sysfs_led_off[64];
+    int smoothing;
+    char curve[16];
+    int ceiling;
+    char mode[16];
+    int overload; // drops/s that turn the LED to 'warn', 0 disables
+    char source[16]; // "link", "softnet" or "conntrack"
+    int queues;      // sample per-queue counters
+    int imbalance;   // percent that switches the blink to green/red, 0 disables
+} INSTANCE_CONF;
+
+typedef struct
+{
+    char log_level[16];
+    int log_rate;
+    int log_burst;
+    int log_ring; // keep debug events in memory, -1 when unset
+} GLOBAL_CONF;
+
+int config_load(const char *path, INSTANCE_CONF **out, GLOBAL_CONF *globals);
+
+#endif
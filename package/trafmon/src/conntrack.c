@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hgledon.h"
+#include "conntrack.h"
+#include "netattr.h"
+
+#define CONNTRACK_STAT_MAX 16384 // header plus one row per cpu
+
+static int open_proc(const char *file)
+{
+    char path[256];
+
+    hgl_path(path, sizeof(path), "%s", file);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static void close_fd(int *fd)
+{
+    if (*fd >= 0)
+        close(*fd);
+    *fd = -1;
+}
+
+// Files that are missing now, e.g. before nf_conntrack loads, are retried on every read
+static void conntrack_open(CONNTRACK *ct)
+{
+    if (ct->count_fd < 0)
+        ct->count_fd = open_proc(CONNTRACK_COUNT);
+    if (ct->max_fd < 0)
+        ct->max_fd = open_proc(CONNTRACK_MAX);
+    if (ct->stat_fd < 0)
+    {
+        ct->stat_fd = open_proc(CONNTRACK_STAT);
+        ct->col_insert_failed = ct->col_drop = ct->col_early_drop = -1;
+    }
+}
+
+CONNTRACK *conntrack_create(void)
+{
+    CONNTRACK *ct = calloc(1, sizeof(*ct));
+
+    if (!ct)
+        return NULL;
+    ct->count_fd = ct->max_fd = ct->stat_fd = -1;
+    conntrack_open(ct);
+    return ct;
+}
+
+void conntrack_free(CONNTRACK *ct)
+{
+    if (!ct)
+        return;
+    close_fd(&ct->count_fd);
+    close_fd(&ct->max_fd);
+    close_fd(&ct->stat_fd);
+    free(ct);
+}
+
+static int read_decimal(int fd, uint64_t *val)
+{
+    char buf[32];
+    ssize_t n = fd < 0 ? -1 : pread(fd, buf, sizeof(buf), 0);
+
+    if (n <= 0)
+        return -1;
+    *val = parse_decimal(buf, n);
+    return 0;
+}
+
+static const char *next_word(const char *p, const char *end, size_t *len)
+{
+    while (p < end && *p == ' ')
+        p++;
+    *len = 0;
+    while (p + *len < end && p[*len] != ' ')
+        (*len)++;
+    return *len ? p : NULL;
+}
+
+static void find_columns(CONNTRACK *ct, const char *p, const char *eol)
+{
+    size_t len;
+
+    for (int col = 0; (p = next_word(p, eol, &len)) != NULL; p += len, col++)
+    {
+        if (len == 13 && memcmp(p, "insert_failed", 13) == 0)
+            ct->col_insert_failed = col;
+        else if (len == 4 && memcmp(p, "drop", 4) == 0)
+            ct->col_drop = col;
+        else if (len == 10 && memcmp(p, "early_drop", 10) == 0)
+            ct->col_early_drop = col;
+    }
+}
+
+static uint64_t parse_hex(const char *p, size_t len)
+{
+    uint64_t v = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int c = (unsigned char)p[i] | 0x20;
+        v = v << 4 | (c <= '9' ? c - '0' : c - 'a' + 10);
+    }
+    return v;
+}
+
+// Sum the failure columns over the per-cpu rows
+static void read_stat(CONNTRACK *ct, CONNTRACK_STATS *st)
+{
+    static char buf[CONNTRACK_STAT_MAX];
+    ssize_t n = ct->stat_fd < 0 ? -1 : pread(ct->stat_fd, buf, sizeof(buf), 0);
+
+    if (n <= 0)
+        return;
+
+    const char *end = buf + n;
+    const char *eol = memchr(buf, '\n', n);
+    if (!eol)
+        return;
+    if (ct->col_drop < 0)
+        find_columns(ct, buf, eol);
+
+    for (const char *p = eol + 1; p < end && (eol = memchr(p, '\n', end - p)) != NULL; p = eol + 1)
+    {
+        size_t len;
+
+        for (int col = 0; (p = next_word(p, eol, &len)) != NULL; p += len, col++)
+        {
+            if (col == ct->col_insert_failed)
+                st->insert_failed += parse_hex(p, len);
+            else if (col == ct->col_drop)
+                st->drop += parse_hex(p, len);
+            else if (col == ct->col_early_drop)
+                st->early_drop += parse_hex(p, len);
+        }
+    }
+}
+
+// The count is required; the statistics add the failure counters when present
+int conntrack_read(CONNTRACK *ct, CONNTRACK_STATS *st)
+{
+    memset(st, 0, sizeof(*st));
+    conntrack_open(ct);
+
+    if (read_decimal(ct->count_fd, &st->count) < 0)
+        return -1;
+    read_decimal(ct->max_fd, &st->max);
+    read_stat(ct, st);
+    return 0;
+}
+
+// Connections the table had no room for
+uint64_t conntrack_failures(const CONNTRACK_STATS *st)
+{
+    return st->insert_failed + st->drop + st->early_drop;
+}
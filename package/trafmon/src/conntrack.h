@@ -0,0 +1,39 @@
+#ifndef CONNTRACK_H
+#define CONNTRACK_H
+
+#include <stdint.h>
+
+// All per network namespace, so a daemon run in a netns sees that table
+#define CONNTRACK_COUNT "/proc/sys/net/netfilter/nf_conntrack_count"
+#define CONNTRACK_MAX "/proc/sys/net/netfilter/nf_conntrack_max"
+#define CONNTRACK_STAT "/proc/net/stat/nf_conntrack"
+#define CONNTRACK_NAME "conntrack" // stands in for the ifname of a conntrack binding
+#define CONNTRACK_PERIOD 2000      // ms; the table fills over seconds, not ticks
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t max;
+    uint64_t insert_failed; // summed over the per-cpu rows
+    uint64_t drop;
+    uint64_t early_drop;
+} CONNTRACK_STATS;
+
+// The three files stay open and are re-read with pread. The stat columns
+// differ between kernels, so they are located by the header once.
+typedef struct
+{
+    int count_fd;
+    int max_fd;
+    int stat_fd;
+    int col_insert_failed;
+    int col_drop;
+    int col_early_drop;
+} CONNTRACK;
+
+CONNTRACK *conntrack_create(void);
+void conntrack_free(CONNTRACK *ct);
+int conntrack_read(CONNTRACK *ct, CONNTRACK_STATS *st);
+uint64_t conntrack_failures(const CONNTRACK_STATS *st);
+
+#endif
@@ -0,0 +1,187 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "hgledon.h"
+#include "ctl.h"
+
+void run_path(char *buf, size_t size, const char *id, const char *ext)
+{
+    hgl_path(buf, size, RUN_DIR "/%s.%s", id, ext);
+}
+
+static int ctl_addr(struct sockaddr_un *sa, const char *path)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa->sun_path))
+        return -1;
+    strcpy(sa->sun_path, path);
+    return 0;
+}
+
+// 1 if a daemon answers on the socket, 0 if it is a leftover nobody listens on, -1 otherwise
+static int ctl_probe(const struct sockaddr_un *sa)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+        return -1;
+
+    int ret = connect(fd, (const struct sockaddr *)sa, sizeof(*sa));
+    int err = errno;
+
+    close(fd);
+    if (ret == 0 || err == EAGAIN)
+        return 1;
+    return err == ECONNREFUSED ? 0 : -1;
+}
+
+// Fails with EADDRINUSE while another daemon owns path
+int ctl_listen(const char *path)
+{
+    struct sockaddr_un sa;
+    char dir[128];
+
+    if (ctl_addr(&sa, path) < 0)
+        return -1;
+
+    hgl_path(dir, sizeof(dir), RUN_DIR);
+    mkdir(dir, 0755);
+
+    // Only a socket left behind by a killed daemon may be replaced
+    int probe = ctl_probe(&sa);
+    if (probe > 0)
+    {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    if (probe == 0)
+        unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    // Created 0600 right away rather than chmod'ed after the fact
+    mode_t mask = umask(0177);
+    int ret = bind(fd, (struct sockaddr *)&sa, sizeof(sa));
+    umask(mask);
+
+    if (ret < 0 || listen(fd, 4) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Answer every pending connection: one request line in, one response out
+void ctl_serve(int lfd, void (*handler)(const char *req, char *resp, size_t size))
+{
+    char req[CTL_MAX_REQ];
+    char resp[CTL_MAX_RESP];
+    int fd;
+
+    while ((fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC)) >= 0)
+    {
+        // Clients write their request right after connecting; don't let one stall the loop
+        struct timeval tv = {.tv_usec = 200000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        ssize_t n = read(fd, req, sizeof(req) - 1);
+        if (n > 0)
+        {
+            req[n] = '\0';
+            req[strcspn(req, "\r\n")] = '\0';
+
+            handler(req, resp, sizeof(resp));
+            // A client that hung up must not take the daemon down with SIGPIPE
+            send(fd, resp, strlen(resp), MSG_NOSIGNAL);
+        }
+        close(fd);
+    }
+}
+
+int ctl_request(const char *path, const char *req, char *resp, size_t size)
+{
+    struct sockaddr_un sa;
+    char line[CTL_MAX_REQ];
+    int len = snprintf(line, sizeof(line), "%s\n", req);
+
+    if (ctl_addr(&sa, path) < 0 || len >= (int)sizeof(line))
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    struct timeval tv = {.tv_sec = 2};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || send(fd, line, len, MSG_NOSIGNAL) < 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    size_t got = 0;
+    ssize_t n;
+    while (got < size - 1 && (n = read(fd, resp + got, size - 1 - got)) > 0)
+        got += n;
+    resp[got] = '\0';
+
+    close(fd);
+    return got;
+}
+
+// Send req to every running daemon; returns how many answered
+int ctl_foreach(const char *req, ctl_cb cb, void *arg)
+{
+    char dir[128];
+    struct dirent *entry;
+    char resp[CTL_MAX_RESP];
+    int count = 0;
+
+    hgl_path(dir, sizeof(dir), RUN_DIR);
+    DIR *d = opendir(dir);
+    if (!d)
+        return 0;
+
+    while ((entry = readdir(d)) != NULL)
+    {
+        char path[128];
+        size_t len = strlen(entry->d_name);
+
+        if (len < 6 || strcmp(entry->d_name + len - 5, ".sock") != 0)
+            continue;
+
+        if (hgl_path(path, sizeof(path), RUN_DIR "/%s", entry->d_name) < 0)
+            continue;
+        if (ctl_request(path, req, resp, sizeof(resp)) < 0)
+        {
+            // Nobody listening any more: the daemon died without cleaning up
+            if (errno == ECONNREFUSED)
+                unlink(path);
+            continue;
+        }
+
+        count++;
+        if (cb)
+            cb(resp, arg);
+    }
+
+    closedir(d);
+    return count;
+}
@@ -0,0 +1,19 @@
+#ifndef CTL_H
+#define CTL_H
+
+#include <stddef.h>
+
+// Every daemon owns <id>.sock (control) and <id>.stats (live samples) in here
+#define RUN_DIR "/var/run/trafmon"
+#define CTL_MAX_REQ 128
+#define CTL_MAX_RESP 16384 // fits the whole debug log ring
+
+typedef void (*ctl_cb)(const char *resp, void *arg);
+
+void run_path(char *buf, size_t size, const char *id, const char *ext);
+int ctl_listen(const char *path);
+void ctl_serve(int lfd, void (*handler)(const char *req, char *resp, size_t size));
+int ctl_request(const char *path, const char *req, char *resp, size_t size);
+int ctl_foreach(const char *req, ctl_cb cb, void *arg);
+
+#endif
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+
+#include "group.h"
+#include "log.h"
+
+IF_GROUP *group_create(const char *name)
+{
+    IF_GROUP *g = calloc(1, sizeof(*g));
+
+    if (g)
+        snprintf(g->name, sizeof(g->name), "%s", name);
+    return g;
+}
+
+void group_free(IF_GROUP *g)
+{
+    free(g);
+}
+
+int group_add_pattern(IF_GROUP *g, const char *pattern)
+{
+    if (g->pattern_count >= GROUP_MAX_PATTERNS)
+        return -1;
+    snprintf(g->patterns[g->pattern_count++], IFNAMSIZ, "%s", pattern);
+    return 0;
+}
+
+int group_add_master(IF_GROUP *g, const char *master)
+{
+    if (g->master_count >= GROUP_MAX_PATTERNS)
+        return -1;
+    snprintf(g->masters[g->master_count++], IFNAMSIZ, "%s", master);
+    return 0;
+}
+
+// Same membership rules; NULL is a plain single-interface binding
+int group_equal(const IF_GROUP *a, const IF_GROUP *b)
+{
+    if (!a || !b)
+        return a == b;
+    if (a->pattern_count != b->pattern_count || a->master_count != b->master_count)
+        return 0;
+
+    for (int i = 0; i < a->pattern_count; i++)
+    {
+        if (strcmp(a->patterns[i], b->patterns[i]) != 0)
+            return 0;
+    }
+    for (int i = 0; i < a->master_count; i++)
+    {
+        if (strcmp(a->masters[i], b->masters[i]) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+void group_begin(IF_GROUP *g)
+{
+    for (int i = 0; i < g->member_count; i++)
+        g->members[i].seen = 0;
+}
+
+static int group_matches(IF_GROUP *g, const LINK_STATS *st)
+{
+    for (int i = 0; i < g->pattern_count; i++)
+    {
+        if (fnmatch(g->patterns[i], st->ifname, 0) == 0)
+            return 1;
+    }
+    for (int i = 0; i < g->master_count; i++)
+    {
+        if (st->master && st->master == g->master_index[i])
+            return 1;
+    }
+    return 0;
+}
+
+static uint64_t delta(uint64_t cur, uint64_t prev)
+{
+    return cur >= prev ? cur - prev : 0;
+}
+
+// Offer one link of the pass. A master seen after its ports in the same
+// dump only picks them up from the next pass on.
+void group_feed(IF_GROUP *g, const LINK_STATS *st)
+{
+    for (int i = 0; i < g->master_count; i++)
+    {
+        if (strcmp(st->ifname, g->masters[i]) == 0)
+            g->master_index[i] = st->ifindex;
+    }
+
+    if (st->removed || !group_matches(g, st))
+        return;
+
+    GROUP_MEMBER *m = NULL;
+    for (int i = 0; i < g->member_count && !m; i++)
+    {
+        if (g->members[i].ifindex == st->ifindex)
+            m = &g->members[i];
+    }
+
+    if (!m)
+    {
+        if (g->member_count >= GROUP_MAX_MEMBERS)
+            return;
+
+        // A new member starts from its current counters and adds nothing this pass
+        m = &g->members[g->member_count++];
+        m->ifindex = st->ifindex;
+        m->rx_bytes = st->rx_bytes;
+        m->tx_bytes = st->tx_bytes;
+        m->rx_packets = st->rx_packets;
+        m->tx_packets = st->tx_packets;
+        m->drops = link_drops(st);
+        m->errors = st->rx_errors + st->tx_errors;
+        log_write(LOG_NOTICE, LOG_CLASS_LINK, "Group %s: %s joined.", g->name, st->ifname);
+    }
+
+    g->total.rx_bytes += delta(st->rx_bytes, m->rx_bytes);
+    g->total.tx_bytes += delta(st->tx_bytes, m->tx_bytes);
+    g->total.rx_packets += delta(st->rx_packets, m->rx_packets);
+    g->total.tx_packets += delta(st->tx_packets, m->tx_packets);
+    g->total.rx_dropped += delta(link_drops(st), m->drops);
+    g->total.rx_errors += delta(st->rx_errors + st->tx_errors, m->errors);
+
+    snprintf(m->ifname, sizeof(m->ifname), "%s", st->ifname);
+    m->rx_bytes = st->rx_bytes;
+    m->tx_bytes = st->tx_bytes;
+    m->rx_packets = st->rx_packets;
+    m->tx_packets = st->tx_packets;
+    m->drops = link_drops(st);
+    m->errors = st->rx_errors + st->tx_errors;
+    m->carrier = st->carrier;
+    m->seen = 1;
+}
+
+// Drop members that weren't in the pass; returns 1 while any member has carrier
+int group_end(IF_GROUP *g, LINK_STATS *out)
+{
+    int carrier = 0;
+
+    for (int i = 0; i < g->member_count;)
+    {
+        GROUP_MEMBER *m = &g->members[i];
+
+        if (!m->seen)
+        {
+            log_write(LOG_NOTICE, LOG_CLASS_LINK, "Group %s: %s left.", g->name, m->ifname);
+            *m = g->members[--g->member_count];
+            continue;
+        }
+        carrier |= m->carrier;
+        i++;
+    }
+
+    g->total.carrier = carrier;
+    *out = g->total;
+    return carrier;
+}
@@ -0,0 +1,51 @@
+#ifndef GROUP_H
+#define GROUP_H
+
+#include <stdint.h>
+#include <net/if.h>
+
+#include "rtnl.h"
+
+#define GROUP_MAX_PATTERNS 8
+#define GROUP_MAX_MEMBERS 16
+
+typedef struct
+{
+    int ifindex;
+    char ifname[IFNAMSIZ];
+    int carrier;
+    int seen;
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint64_t drops;
+    uint64_t errors;
+} GROUP_MEMBER;
+
+// Interfaces matched by name globs or by their bridge/bond master. The
+// total only ever grows by member deltas, so joins and leaves don't spike it.
+// Its drop counters are folded into rx_dropped, its errors into rx_errors.
+typedef struct
+{
+    char name[32];
+    char patterns[GROUP_MAX_PATTERNS][IFNAMSIZ];
+    int pattern_count;
+    char masters[GROUP_MAX_PATTERNS][IFNAMSIZ];
+    int master_index[GROUP_MAX_PATTERNS];
+    int master_count;
+    GROUP_MEMBER members[GROUP_MAX_MEMBERS];
+    int member_count;
+    LINK_STATS total;
+} IF_GROUP;
+
+IF_GROUP *group_create(const char *name);
+void group_free(IF_GROUP *g);
+int group_add_pattern(IF_GROUP *g, const char *pattern);
+int group_add_master(IF_GROUP *g, const char *master);
+int group_equal(const IF_GROUP *a, const IF_GROUP *b);
+void group_begin(IF_GROUP *g);
+void group_feed(IF_GROUP *g, const LINK_STATS *st);
+int group_end(IF_GROUP *g, LINK_STATS *out);
+
+#endif
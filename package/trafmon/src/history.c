@@ -0,0 +1,405 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "history.h"
+
+#define HISTORY_RETRIES 100
+
+// 1 s for an hour, 1 min for a day, 1 h for a week
+static const uint32_t tier_layout[HISTORY_TIERS][2] = {{1, 3600}, {60, 1440}, {3600, 168}};
+
+static size_t history_used;
+static char history_dir[64] = HISTORY_DIR;
+
+static size_t history_size(void)
+{
+    size_t n = 0;
+
+    for (int t = 0; t < HISTORY_TIERS; t++)
+        n += tier_layout[t][1];
+    return sizeof(HIST_FILE) + n * sizeof(HIST_BUCKET);
+}
+
+// Section names are plain words, but a glob or a path separator must not reach the file name
+static void history_key(char *buf, size_t size, const char *name)
+{
+    size_t i = 0;
+
+    for (; name[i] && i < size - 1; i++)
+    {
+        char c = name[i];
+
+        if ((c < 'a' || c > 'z') && (c < 'A' || c > 'Z') && (c < '0' || c > '9') && c != '-')
+            c = '_';
+        buf[i] = c;
+    }
+    buf[i] = '\0';
+}
+
+static void history_path(char *buf, size_t size, const char *dir, const char *name)
+{
+    char key[64];
+
+    history_key(key, sizeof(key), name);
+    snprintf(buf, size, "%s/%s.hist", dir, key);
+}
+
+// Each daemon keeps its files in a directory of its own, so pruning never touches another's
+void history_owner(const char *id)
+{
+    char key[32];
+
+    history_key(key, sizeof(key), id);
+    snprintf(history_dir, sizeof(history_dir), HISTORY_DIR "/%s", key);
+}
+
+// A file left by an earlier run of the daemon is kept if the layout still matches
+static int history_valid(const HIST_FILE *f, size_t size)
+{
+    uint32_t offset = 0;
+
+    if (f->magic != HISTORY_MAGIC || f->size != size)
+        return 0;
+
+    for (int t = 0; t < HISTORY_TIERS; t++)
+    {
+        if (f->tiers[t].step != tier_layout[t][0] || f->tiers[t].len != tier_layout[t][1] ||
+            f->tiers[t].offset != offset)
+            return 0;
+        offset += f->tiers[t].len;
+    }
+    return 1;
+}
+
+HISTORY *history_create(const char *name, const char *ifname)
+{
+    char path[160];
+    size_t size = history_size();
+
+    if (history_used + size > HISTORY_MEM_CAP)
+        return NULL;
+
+    mkdir(HISTORY_DIR, 0755);
+    mkdir(history_dir, 0755);
+    history_path(path, sizeof(path), history_dir, name);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return NULL;
+
+    struct stat sb;
+    int reuse = fstat(fd, &sb) == 0 && (size_t)sb.st_size == size;
+
+    if (!reuse && ftruncate(fd, 0) < 0)
+        reuse = -1;
+    if (reuse < 0 || (!reuse && ftruncate(fd, size) < 0))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    HIST_FILE *f = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (f == MAP_FAILED)
+        return NULL;
+
+    HISTORY *h = calloc(1, sizeof(*h));
+    if (!h)
+    {
+        munmap(f, size);
+        return NULL;
+    }
+
+    // A section moved to another interface starts over
+    if (!reuse || !history_valid(f, size) || strncmp(f->ifname, ifname, sizeof(f->ifname)) != 0)
+    {
+        uint32_t offset = 0;
+
+        memset(f, 0, size);
+        f->size = size;
+        snprintf(f->ifname, sizeof(f->ifname), "%s", ifname);
+        for (int t = 0; t < HISTORY_TIERS; t++)
+        {
+            f->tiers[t].step = tier_layout[t][0];
+            f->tiers[t].len = tier_layout[t][1];
+            f->tiers[t].offset = offset;
+            f->tiers[t].first = -1;
+            f->tiers[t].last = -1;
+            offset += tier_layout[t][1];
+        }
+        __atomic_store_n(&f->magic, HISTORY_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    for (int t = 0; t < HISTORY_TIERS; t++)
+        h->open[t] = -1;
+
+    h->file = f;
+    history_used += size;
+    return h;
+}
+
+// The file stays in tmpfs so history survives a daemon restart
+void history_close(HISTORY *h)
+{
+    if (!h)
+        return;
+
+    history_used -= h->file->size;
+    munmap(h->file, h->file->size);
+    free(h);
+}
+
+// Store bucket n of tier t, zeroing any buckets skipped since the last one
+static void close_bucket(HISTORY *h, int t, int64_t n)
+{
+    HIST_TIER *tier = &h->file->tiers[t];
+    HIST_BUCKET *ring = h->file->buckets + tier->offset;
+    uint64_t step_ms = tier->step * 1000ULL;
+    uint64_t rx = h->acc_rx[t] * 1000 / step_ms;
+    uint64_t tx = h->acc_tx[t] * 1000 / step_ms;
+
+    if (tier->last >= 0 && n > tier->last + 1)
+    {
+        int64_t from = n - tier->last > tier->len ? n - tier->len : tier->last + 1;
+        for (int64_t k = from; k < n; k++)
+            ring[k % tier->len] = (HIST_BUCKET){0, 0};
+    }
+
+    ring[n % tier->len] = (HIST_BUCKET){rx > UINT32_MAX ? UINT32_MAX : rx, tx > UINT32_MAX ? UINT32_MAX : tx};
+    if (tier->first < 0)
+        tier->first = n;
+    tier->last = n;
+
+    h->acc_rx[t] = 0;
+    h->acc_tx[t] = 0;
+}
+
+// Account bytes transferred since the previous call, spread evenly over that interval
+void history_add(HISTORY *h, long now_ms, uint64_t rx_bytes, uint64_t tx_bytes)
+{
+    HIST_FILE *f = h->file;
+    long from = h->last_ms;
+    int closing = 0;
+
+    if (!from || now_ms <= from)
+    {
+        from = now_ms;
+        rx_bytes = tx_bytes = 0;
+    }
+    h->last_ms = now_ms;
+
+    for (int t = 0; t < HISTORY_TIERS; t++)
+    {
+        long step_ms = f->tiers[t].step * 1000L;
+        long span = now_ms - from;
+        long pos = from;
+
+        do
+        {
+            int64_t n = pos / step_ms;
+            long end = (n + 1) * step_ms < now_ms ? (n + 1) * step_ms : now_ms;
+
+            if (n != h->open[t])
+            {
+                if (h->open[t] >= 0)
+                {
+                    if (!closing++)
+                    {
+                        __atomic_store_n(&f->seq, f->seq + 1, __ATOMIC_RELAXED);
+                        __atomic_thread_fence(__ATOMIC_RELEASE);
+                    }
+                    close_bucket(h, t, h->open[t]);
+                }
+                h->open[t] = n;
+            }
+
+            if (span > 0)
+            {
+                h->acc_rx[t] += rx_bytes * (end - pos) / span;
+                h->acc_tx[t] += tx_bytes * (end - pos) / span;
+            }
+            pos = end;
+        } while (pos < now_ms);
+    }
+
+    if (closing)
+        __atomic_store_n(&f->seq, f->seq + 1, __ATOMIC_RELEASE);
+}
+
+static void prune_dir(const char *dir, const char *const *names, int n)
+{
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+
+    if (!d)
+        return;
+
+    while ((entry = readdir(d)))
+    {
+        char key[64], path[160];
+        size_t len = strlen(entry->d_name);
+        int live = 0;
+
+        if (len < 6 || strcmp(entry->d_name + len - 5, ".hist") != 0)
+            continue;
+
+        for (int i = 0; i < n && !live; i++)
+        {
+            history_key(key, sizeof(key), names[i]);
+            live = strlen(key) == len - 5 && strncmp(key, entry->d_name, len - 5) == 0;
+        }
+
+        if (!live)
+        {
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+        }
+    }
+
+    closedir(d);
+}
+
+// Remove the files of this daemon that none of names records any more, and
+// those of the older layout with one file per interface straight in HISTORY_DIR
+void history_prune(const char *const *names, int n)
+{
+    prune_dir(history_dir, names, n);
+    prune_dir(HISTORY_DIR, NULL, 0);
+}
+
+static HIST_FILE *history_map(const char *path)
+{
+    size_t size = history_size();
+    struct stat sb;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &sb) < 0 || (size_t)sb.st_size != size)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    HIST_FILE *f = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (f == MAP_FAILED)
+        return NULL;
+
+    if (!history_valid(f, size))
+    {
+        munmap(f, size);
+        return NULL;
+    }
+    return f;
+}
+
+// key is a section name, or failing that the interface a file records, in any daemon's directory
+HIST_FILE *history_open(const char *key)
+{
+    DIR *d = opendir(HISTORY_DIR);
+    struct dirent *entry;
+    HIST_FILE *found = NULL;
+
+    if (!d)
+        return NULL;
+
+    while (!found && (entry = readdir(d)))
+    {
+        char dir[sizeof(HISTORY_DIR) + 256];
+        char path[sizeof(dir) + 72];
+
+        if (entry->d_name[0] == '.')
+            continue;
+
+        snprintf(dir, sizeof(dir), HISTORY_DIR "/%s", entry->d_name);
+        history_path(path, sizeof(path), dir, key);
+        found = history_map(path);
+    }
+
+    rewinddir(d);
+    while (!found && (entry = readdir(d)))
+    {
+        char dir[sizeof(HISTORY_DIR) + 256];
+
+        if (entry->d_name[0] == '.')
+            continue;
+
+        snprintf(dir, sizeof(dir), HISTORY_DIR "/%s", entry->d_name);
+        DIR *sub = opendir(dir);
+        struct dirent *e;
+
+        while (sub && !found && (e = readdir(sub)))
+        {
+            char path[sizeof(dir) + 256];
+            size_t len = strlen(e->d_name);
+
+            if (len < 6 || strcmp(e->d_name + len - 5, ".hist") != 0)
+                continue;
+
+            snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+            found = history_map(path);
+            if (found && strncmp(found->ifname, key, sizeof(found->ifname)) != 0)
+            {
+                history_unmap(found);
+                found = NULL;
+            }
+        }
+        if (sub)
+            closedir(sub);
+    }
+
+    closedir(d);
+    return found;
+}
+
+void history_unmap(HIST_FILE *f)
+{
+    if (f)
+        munmap(f, f->size);
+}
+
+// Copy up to max of the newest closed buckets of a tier, oldest first
+int history_read(const HIST_FILE *f, int tier, HIST_BUCKET *out, int max, int64_t *last)
+{
+    const HIST_TIER *tr = &f->tiers[tier];
+    const HIST_BUCKET *ring = f->buckets + tr->offset;
+
+    for (int tries = 0; tries < HISTORY_RETRIES; tries++)
+    {
+        uint32_t seq = __atomic_load_n(&f->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue;
+
+        int64_t first = tr->first;
+        int64_t newest = tr->last;
+        int n = 0;
+
+        if (newest >= 0)
+        {
+            int64_t avail = newest - first + 1;
+            n = avail < max ? (int)avail : max;
+            if (n > (int)tr->len)
+                n = tr->len;
+            for (int i = 0; i < n; i++)
+                out[i] = ring[(newest - n + 1 + i) % tr->len];
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&f->seq, __ATOMIC_RELAXED) == seq)
+        {
+            *last = newest;
+            return n;
+        }
+    }
+
+    return -1;
+}
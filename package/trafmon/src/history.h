@@ -0,0 +1,61 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <net/if.h>
+
+#define HISTORY_DIR "/tmp/trafmon" // one directory per daemon id, one file per section
+#define HISTORY_MAGIC 0x544d4831 // "TMH1"
+#define HISTORY_TIERS 3
+#define HISTORY_MEM_CAP (512 * 1024) // all history files of one daemon together
+
+// Average bytes/s over one bucket
+typedef struct
+{
+    uint32_t rx;
+    uint32_t tx;
+} HIST_BUCKET;
+
+// Bucket n covers CLOCK_MONOTONIC seconds [n * step, (n + 1) * step)
+typedef struct
+{
+    uint32_t step;
+    uint32_t len;
+    uint32_t offset;
+    uint32_t pad;
+    int64_t first;
+    int64_t last;
+} HIST_TIER;
+
+// Readers take a snapshot under seq, which is odd while buckets are being closed
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t size;
+    uint32_t pad;
+    char ifname[IFNAMSIZ];
+    HIST_TIER tiers[HISTORY_TIERS];
+    HIST_BUCKET buckets[];
+} HIST_FILE;
+
+typedef struct
+{
+    HIST_FILE *file;
+    long last_ms;
+    int64_t open[HISTORY_TIERS];
+    uint64_t acc_rx[HISTORY_TIERS];
+    uint64_t acc_tx[HISTORY_TIERS];
+} HISTORY;
+
+void history_owner(const char *id);
+HISTORY *history_create(const char *name, const char *ifname);
+void history_close(HISTORY *h);
+void history_prune(const char *const *names, int n);
+void history_add(HISTORY *h, long now_ms, uint64_t rx_bytes, uint64_t tx_bytes);
+HIST_FILE *history_open(const char *key);
+void history_unmap(HIST_FILE *f);
+int history_read(const HIST_FILE *f, int tier, HIST_BUCKET *out, int max, int64_t *last);
+
+#endif
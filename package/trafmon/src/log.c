@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "log.h"
+
+#define LOG_DEFAULT_RATE 5   // messages per second per class
+#define LOG_DEFAULT_BURST 20
+
+typedef struct
+{
+    long last_ms;
+    int tokens;
+    unsigned long suppressed;
+} LOG_BUCKET;
+
+typedef struct
+{
+    long ms;
+    char msg[LOG_LINE_MAX];
+} LOG_ENTRY;
+
+static const char *level_names[] = {
+    [LOG_ERR] = "error",
+    [LOG_WARNING] = "warning",
+    [LOG_NOTICE] = "notice",
+    [LOG_INFO] = "info",
+    [LOG_DEBUG] = "debug",
+};
+
+static int log_opened;
+static int log_level = LOG_INFO;
+static int log_rate = LOG_DEFAULT_RATE;
+static int log_burst = LOG_DEFAULT_BURST;
+static LOG_BUCKET buckets[LOG_CLASS_COUNT];
+
+// While on, debug events are kept here regardless of the level and only leave on request
+static int ring_on;
+static LOG_ENTRY ring[LOG_RING_SIZE];
+static unsigned int ring_head;
+
+static long log_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+void log_open(const char *ident)
+{
+    if (log_opened)
+        return;
+
+    openlog(ident, LOG_PID | LOG_CONS, LOG_DAEMON);
+    log_opened = 1;
+}
+
+void log_close(void)
+{
+    if (log_opened)
+        closelog();
+    log_opened = 0;
+}
+
+void log_set_level(int level)
+{
+    log_level = level;
+}
+
+int log_get_level(void)
+{
+    return log_level;
+}
+
+void log_set_ring(int on)
+{
+    ring_on = on;
+}
+
+// Back to the built-in settings, before a config applies its own
+void log_defaults(void)
+{
+    log_level = LOG_INFO;
+    ring_on = 0;
+    log_set_rate(LOG_DEFAULT_RATE, LOG_DEFAULT_BURST);
+}
+
+int log_parse_level(const char *name)
+{
+    for (size_t i = 0; i < sizeof(level_names) / sizeof(level_names[0]); i++)
+    {
+        if (level_names[i] && strcmp(level_names[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void log_set_rate(int per_sec, int burst)
+{
+    log_rate = per_sec;
+    log_burst = burst > 0 ? burst : LOG_DEFAULT_BURST;
+    memset(buckets, 0, sizeof(buckets));
+}
+
+// Refill by elapsed time; 0 disables limiting
+static int log_allow(log_class_t cls)
+{
+    LOG_BUCKET *b = &buckets[cls];
+    long now = log_now_ms();
+
+    if (log_rate <= 0)
+        return 1;
+
+    if (!b->last_ms)
+    {
+        b->last_ms = now;
+        b->tokens = log_burst;
+    }
+
+    long refill = (now - b->last_ms) * log_rate / 1000;
+    if (refill > 0)
+    {
+        b->tokens = b->tokens + refill > log_burst ? log_burst : b->tokens + refill;
+        b->last_ms += refill * 1000 / log_rate;
+    }
+
+    if (b->tokens <= 0)
+    {
+        b->suppressed++;
+        return 0;
+    }
+
+    b->tokens--;
+    if (b->suppressed)
+    {
+        syslog(LOG_NOTICE, "%lu messages suppressed by rate limiting", b->suppressed);
+        b->suppressed = 0;
+    }
+    return 1;
+}
+
+// Debug events are formatted only when syslog or the ring will take them, so per-tick ones cost a compare
+void log_write(int level, log_class_t cls, const char *fmt, ...)
+{
+    if (level > log_level && !(level == LOG_DEBUG && ring_on))
+        return;
+
+    char msg[LOG_LINE_MAX];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+
+    if (level == LOG_DEBUG && ring_on)
+    {
+        LOG_ENTRY *e = &ring[ring_head++ % LOG_RING_SIZE];
+        e->ms = log_now_ms();
+        memcpy(e->msg, msg, sizeof(msg));
+
+        if (level > log_level)
+            return;
+    }
+
+    log_open("trafmon");
+    if (log_allow(cls))
+        syslog(level, "%s", msg);
+}
+
+// Oldest first, one "<age ms> <message>" per line
+int log_ring_dump(char *buf, size_t size)
+{
+    unsigned int n = ring_head < LOG_RING_SIZE ? ring_head : LOG_RING_SIZE;
+    long now = log_now_ms();
+    int len = 0;
+
+    buf[0] = '\0';
+    for (unsigned int i = ring_head - n; i != ring_head && len < (int)size; i++)
+    {
+        const LOG_ENTRY *e = &ring[i % LOG_RING_SIZE];
+        len += snprintf(buf + len, size - len, "-%ldms %s\n", now - e->ms, e->msg);
+    }
+    return len < (int)size ? len : (int)size - 1;
+}
+
+void log_ring_flush(void)
+{
+    unsigned int n = ring_head < LOG_RING_SIZE ? ring_head : LOG_RING_SIZE;
+
+    log_open("trafmon");
+    for (unsigned int i = ring_head - n; i != ring_head; i++)
+        syslog(LOG_DEBUG, "[ring] %s", ring[i % LOG_RING_SIZE].msg);
+    ring_head = 0;
+}
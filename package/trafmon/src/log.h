@@ -0,0 +1,32 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <syslog.h>
+
+#define LOG_RING_SIZE 64
+#define LOG_LINE_MAX 160
+
+// Each class has its own token bucket, so a flapping link can't starve the rest
+typedef enum
+{
+    LOG_CLASS_GENERAL,
+    LOG_CLASS_LINK,
+    LOG_CLASS_TRAFFIC,
+    LOG_CLASS_CTL,
+    LOG_CLASS_COUNT
+} log_class_t;
+
+void log_open(const char *ident);
+void log_close(void);
+void log_set_level(int level);
+int log_get_level(void);
+void log_set_ring(int on);
+void log_defaults(void);
+int log_parse_level(const char *name);
+void log_set_rate(int per_sec, int burst);
+void log_write(int level, log_class_t cls, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int log_ring_dump(char *buf, size_t size);
+void log_ring_flush(void);
+
+#endif
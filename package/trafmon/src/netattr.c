@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hgledon.h"
+#include "netattr.h"
+
+#define NETATTR_BUF 32 // a 64-bit counter in decimal plus the newline
+
+static const char *attr_names[NET_ATTR_COUNT] = {
+    [NET_RX_BYTES] = "statistics/rx_bytes",
+    [NET_TX_BYTES] = "statistics/tx_bytes",
+    [NET_RX_PACKETS] = "statistics/rx_packets",
+    [NET_TX_PACKETS] = "statistics/tx_packets",
+    [NET_RX_DROPPED] = "statistics/rx_dropped",
+    [NET_TX_DROPPED] = "statistics/tx_dropped",
+    [NET_RX_ERRORS] = "statistics/rx_errors",
+    [NET_TX_ERRORS] = "statistics/tx_errors",
+    [NET_RX_MISSED] = "statistics/rx_missed_errors",
+    [NET_RX_FIFO] = "statistics/rx_fifo_errors",
+    [NET_RX_OVER] = "statistics/rx_over_errors",
+    [NET_CARRIER] = "carrier",
+    [NET_IFINDEX] = "ifindex",
+    [NET_SPEED] = "speed",
+};
+
+void netattr_init(NET_ATTRS *na, const char *ifname)
+{
+    memset(na, 0, sizeof(*na));
+    snprintf(na->ifname, sizeof(na->ifname), "%s", ifname);
+    for (int i = 0; i < NET_ATTR_COUNT; i++)
+        na->fd[i] = -1;
+}
+
+void netattr_close(NET_ATTRS *na)
+{
+    for (int i = 0; i < NET_ATTR_COUNT; i++)
+    {
+        if (na->fd[i] >= 0)
+            close(na->fd[i]);
+        na->fd[i] = -1;
+    }
+}
+
+// Stops at the newline or anything else that isn't a digit; "-1" reads as 0
+uint64_t parse_decimal(const char *p, size_t len)
+{
+    uint64_t v = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int d = (unsigned char)p[i] - '0';
+
+        if (d > 9)
+            break;
+        v = v * 10 + d;
+    }
+    return v;
+}
+
+int netattr_read(NET_ATTRS *na, net_attr_t attr, uint64_t *val)
+{
+    char buf[NETATTR_BUF];
+    ssize_t n = -1;
+
+    // An interface that was removed and recreated leaves the old fd on
+    // ENODEV; reopen once by name
+    for (int tries = 0; tries < 2; tries++)
+    {
+        if (na->fd[attr] < 0)
+        {
+            char path[256];
+
+            hgl_path(path, sizeof(path), "/sys/class/net/%s/%s", na->ifname, attr_names[attr]);
+            if ((na->fd[attr] = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+                return -1;
+        }
+
+        n = pread(na->fd[attr], buf, sizeof(buf), 0);
+        if (n >= 0 || errno != ENODEV)
+            break;
+        close(na->fd[attr]);
+        na->fd[attr] = -1;
+    }
+
+    // Reading carrier fails with EINVAL while the interface is down
+    if (n <= 0)
+        return -1;
+    *val = parse_decimal(buf, n);
+    return 0;
+}
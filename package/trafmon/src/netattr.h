@@ -0,0 +1,41 @@
+#ifndef NETATTR_H
+#define NETATTR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <net/if.h>
+
+typedef enum
+{
+    NET_RX_BYTES,
+    NET_TX_BYTES,
+    NET_RX_PACKETS,
+    NET_TX_PACKETS,
+    NET_RX_DROPPED,
+    NET_TX_DROPPED,
+    NET_RX_ERRORS,
+    NET_TX_ERRORS,
+    NET_RX_MISSED,
+    NET_RX_FIFO,
+    NET_RX_OVER,
+    NET_CARRIER,
+    NET_IFINDEX,
+    NET_SPEED,
+    NET_ATTR_COUNT
+} net_attr_t;
+
+// The sysfs attributes of one interface. Each is opened on first use and
+// then re-read in place with pread, so a sample costs one syscall.
+typedef struct
+{
+    char ifname[IFNAMSIZ];
+    int fd[NET_ATTR_COUNT];
+    int seen; // for caches that sweep interfaces which went away
+} NET_ATTRS;
+
+void netattr_init(NET_ATTRS *na, const char *ifname);
+void netattr_close(NET_ATTRS *na);
+int netattr_read(NET_ATTRS *na, net_attr_t attr, uint64_t *val);
+uint64_t parse_decimal(const char *p, size_t len);
+
+#endif
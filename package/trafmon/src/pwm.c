@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sched.h>
+#include <time.h>
+
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+
+#include "pwm.h"
+
+#define PWM_PERIOD_NS (PWM_PERIOD_US * 1000LL)
+#define PWM_WARMUP 100          // periods measured before judging the GPIOs
+#define PWM_MAX_WRITE_PCT 5     // two writes per period may use this much of it
+#define PWM_MAX_JITTER_PCT 20   // average wakeup lateness, relative to the period
+
+#define PWM_ON_BITS 1  // pin_on high, pin_off low
+#define PWM_OFF_BITS 2 // pin_on low, pin_off high
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Fields shared between the owner and the thread always move atomically
+#define SHARED_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define SHARED_STORE(field, v) __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+
+// Integer EWMA with a 1/8 weight, plenty to smooth per-period noise
+static long ewma8(long avg, long sample)
+{
+    return avg + (sample - avg) / 8;
+}
+
+static void pwm_write(PWM_CHANNEL *ch, unsigned int bits, unsigned int *last)
+{
+    if (bits == *last)
+        return;
+
+    int64_t t0 = now_ns();
+    if (gpio_pair_write(&ch->pair, bits) < 0)
+        SHARED_STORE(ch->failed, 1);
+    SHARED_STORE(ch->stats.write_avg_ns, ewma8(ch->stats.write_avg_ns, now_ns() - t0));
+    *last = bits;
+}
+
+// Sleep until an absolute deadline and record how late the wakeup was
+static int64_t pwm_wait(PWM_CHANNEL *ch, int tfd, int64_t deadline)
+{
+    struct itimerspec its = {.it_value = {deadline / 1000000000LL, deadline % 1000000000LL}};
+    uint64_t expirations;
+
+    timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+    if (read(tfd, &expirations, sizeof(expirations)) < 0)
+        return now_ns();
+
+    int64_t now = now_ns();
+    long lateness = now - deadline;
+
+    SHARED_STORE(ch->stats.jitter_avg_ns, ewma8(ch->stats.jitter_avg_ns, lateness));
+    if (lateness > ch->stats.jitter_max_ns)
+        SHARED_STORE(ch->stats.jitter_max_ns, lateness);
+    return now;
+}
+
+static int pwm_too_costly(const PWM_CHANNEL *ch)
+{
+    if (ch->stats.periods < PWM_WARMUP)
+        return 0;
+    return ch->stats.write_avg_ns * 2 > PWM_PERIOD_NS * PWM_MAX_WRITE_PCT / 100 ||
+           ch->stats.jitter_avg_ns > PWM_PERIOD_NS * PWM_MAX_JITTER_PCT / 100;
+}
+
+static void *pwm_thread(void *arg)
+{
+    PWM_CHANNEL *ch = arg;
+    unsigned int last = ~0u;
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+    if (tfd < 0)
+    {
+        SHARED_STORE(ch->failed, 1);
+        return NULL;
+    }
+
+    // Best effort: a realtime slot and tight timer slack keep the edges where they belong
+    struct sched_param sp = {.sched_priority = 1};
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    prctl(PR_SET_TIMERSLACK, 1UL);
+
+    int64_t start = now_ns();
+
+    while (SHARED_LOAD(ch->running) && !SHARED_LOAD(ch->failed))
+    {
+        int duty = SHARED_LOAD(ch->duty);
+        int64_t end = start + PWM_PERIOD_NS;
+
+        if (duty <= 0 || duty >= PWM_STEPS)
+        {
+            // Solid levels need no edges; hold them and just check back every period
+            unsigned int bits = duty ? PWM_ON_BITS : 0;
+
+            if (duty == PWM_HOLD_WARN)
+                bits = PWM_ON_BITS | PWM_OFF_BITS;
+            else if (duty < 0)
+                bits = PWM_OFF_BITS;
+            pwm_write(ch, bits, &last);
+            pwm_wait(ch, tfd, end);
+        }
+        else
+        {
+            pwm_write(ch, PWM_ON_BITS, &last);
+            pwm_wait(ch, tfd, start + PWM_PERIOD_NS * duty / PWM_STEPS);
+            pwm_write(ch, 0, &last);
+            int64_t now = pwm_wait(ch, tfd, end);
+
+            SHARED_STORE(ch->stats.periods, ch->stats.periods + 1);
+            if (now - end > PWM_PERIOD_NS)
+            {
+                // Lost whole periods; restart from now instead of racing to catch up
+                SHARED_STORE(ch->stats.late, ch->stats.late + 1);
+                end = now;
+            }
+            if (pwm_too_costly(ch))
+                SHARED_STORE(ch->failed, 1);
+        }
+
+        start = end;
+    }
+
+    close(tfd);
+    return NULL;
+}
+
+int pwm_start(PWM_CHANNEL *ch, int pin_on, int pin_off)
+{
+    memset(ch, 0, sizeof(*ch));
+    if (gpio_pair_open(pin_on, pin_off, &ch->pair) < 0)
+        return -1;
+
+    // Signals stay with the main thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    ch->running = 1;
+    int ret = pthread_create(&ch->thread, NULL, pwm_thread, ch);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (ret != 0)
+    {
+        ch->running = 0;
+        gpio_pair_release(&ch->pair);
+        return -1;
+    }
+    return 0;
+}
+
+void pwm_stop(PWM_CHANNEL *ch)
+{
+    if (!ch->running)
+        return;
+
+    SHARED_STORE(ch->running, 0);
+    pthread_join(ch->thread, NULL);
+    gpio_pair_release(&ch->pair);
+}
+
+void pwm_set_duty(PWM_CHANNEL *ch, int duty)
+{
+    SHARED_STORE(ch->duty, duty);
+}
+
+int pwm_failed(const PWM_CHANNEL *ch)
+{
+    return SHARED_LOAD(ch->failed);
+}
+
+void pwm_get_stats(const PWM_CHANNEL *ch, PWM_STATS *out)
+{
+    out->periods = SHARED_LOAD(ch->stats.periods);
+    out->late = SHARED_LOAD(ch->stats.late);
+    out->jitter_avg_ns = SHARED_LOAD(ch->stats.jitter_avg_ns);
+    out->jitter_max_ns = SHARED_LOAD(ch->stats.jitter_max_ns);
+    out->write_avg_ns = SHARED_LOAD(ch->stats.write_avg_ns);
+}
@@ -0,0 +1,40 @@
+#ifndef PWM_H
+#define PWM_H
+
+#include <pthread.h>
+
+#include "hgledon.h"
+
+#define PWM_PERIOD_US 10000 // 100 Hz, above visible flicker
+#define PWM_STEPS 1000      // duty in permille
+#define PWM_HOLD_OFF -1     // park on the 'off' color instead of modulating
+#define PWM_HOLD_WARN -2    // park on both colors
+
+typedef struct
+{
+    unsigned long periods;
+    unsigned long late; // periods lost to a wakeup more than one period late
+    long jitter_avg_ns;
+    long jitter_max_ns;
+    long write_avg_ns;
+} PWM_STATS;
+
+// One software PWM on a bicolor LED. The owner only sets the duty; the thread
+// does every GPIO write and fills in the measurements.
+typedef struct
+{
+    GPIO_PAIR pair;
+    pthread_t thread;
+    int running;
+    int duty;
+    int failed;
+    PWM_STATS stats;
+} PWM_CHANNEL;
+
+int pwm_start(PWM_CHANNEL *ch, int pin_on, int pin_off);
+void pwm_stop(PWM_CHANNEL *ch);
+void pwm_set_duty(PWM_CHANNEL *ch, int duty);
+int pwm_failed(const PWM_CHANNEL *ch);
+void pwm_get_stats(const PWM_CHANNEL *ch, PWM_STATS *out);
+
+#endif
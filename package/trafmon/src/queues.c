@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+
+#include "queues.h"
+
+// Per-queue packet counters, by the names the drivers give them
+static const char *rx_templates[] = {
+    "rx_queue_%u_packets%n", // virtio_net, igb, ixgbe, ice, ena
+    "rx-%u.packets%n",       // i40e
+    "rx%u_packets%n",        // mlx5
+    "q%u_rx_pkt_n%n",        // stmmac
+    NULL,
+};
+
+static const char *tx_templates[] = {
+    "tx_queue_%u_packets%n",
+    "tx-%u.packets%n",
+    "tx%u_packets%n",
+    "q%u_tx_pkt_n%n",
+    NULL,
+};
+
+static int ioctl_fd = -1; // shared by every binding for the daemon's lifetime
+
+static int eth_ioctl(const char *ifname, void *cmd)
+{
+    struct ifreq ifr;
+
+    if (ioctl_fd < 0 && (ioctl_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+        return -1;
+
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    ifr.ifr_data = cmd;
+    return ioctl(ioctl_fd, SIOCETHTOOL, &ifr);
+}
+
+// The kernel writes as many entries as the driver has now, whatever the
+// caller asked for, so the buffers are always sized from a fresh count
+static int stats_count(const char *ifname)
+{
+    struct
+    {
+        struct ethtool_sset_info hdr;
+        uint32_t len;
+    } info;
+
+    memset(&info, 0, sizeof(info));
+    info.hdr.cmd = ETHTOOL_GSSET_INFO;
+    info.hdr.sset_mask = 1ULL << ETH_SS_STATS;
+    if (eth_ioctl(ifname, &info) < 0)
+        return -1;
+    return info.hdr.sset_mask ? (int)info.len : 0;
+}
+
+static int match_queue(const char *name, const char **templates)
+{
+    size_t len = strlen(name);
+
+    for (int i = 0; templates[i]; i++)
+    {
+        unsigned int queue;
+        int end = -1;
+
+        if (sscanf(name, templates[i], &queue, &end) == 1 && end == (int)len && queue < QUEUE_MAX)
+            return (int)queue;
+    }
+    return -1;
+}
+
+static int discover(QUEUE_STATS *q, const char *ifname, int n)
+{
+    struct ethtool_gstrings *gs = calloc(1, sizeof(*gs) + (size_t)n * ETH_GSTRING_LEN);
+    void *stats = calloc(1, sizeof(struct ethtool_stats) + (size_t)n * sizeof(uint64_t));
+
+    if (gs)
+    {
+        gs->cmd = ETHTOOL_GSTRINGS;
+        gs->string_set = ETH_SS_STATS;
+        gs->len = n;
+    }
+    if (!gs || !stats || (n && eth_ioctl(ifname, gs) < 0))
+    {
+        free(gs);
+        free(stats);
+        return -1;
+    }
+
+    q->rx_count = 0;
+    q->tx_count = 0;
+    for (int i = 0; i < QUEUE_MAX; i++)
+        q->rx_index[i] = q->tx_index[i] = -1;
+
+    for (int i = 0; i < n; i++)
+    {
+        char name[ETH_GSTRING_LEN + 1];
+        int queue;
+
+        memcpy(name, gs->data + (size_t)i * ETH_GSTRING_LEN, ETH_GSTRING_LEN);
+        name[ETH_GSTRING_LEN] = '\0';
+
+        if ((queue = match_queue(name, rx_templates)) >= 0)
+        {
+            q->rx_index[queue] = i;
+            if (queue >= q->rx_count)
+                q->rx_count = queue + 1;
+        }
+        else if ((queue = match_queue(name, tx_templates)) >= 0)
+        {
+            q->tx_index[queue] = i;
+            if (queue >= q->tx_count)
+                q->tx_count = queue + 1;
+        }
+    }
+
+    free(gs);
+    free(q->stats);
+    q->stats = stats;
+    q->n_stats = n;
+    q->primed = 0;
+    return 0;
+}
+
+QUEUE_STATS *queues_create(void)
+{
+    QUEUE_STATS *q = calloc(1, sizeof(*q));
+
+    if (q)
+        q->n_stats = -1;
+    return q;
+}
+
+void queues_free(QUEUE_STATS *q)
+{
+    if (!q)
+        return;
+    free(q->stats);
+    free(q);
+}
+
+// Share of the busiest queue, scaled so an even spread is 0 whatever the queue count
+static void balance(const __u64 *data, const int *index, uint64_t *prev, int count, int primed, long elapsed,
+                    QUEUE_BALANCE *out)
+{
+    uint64_t total = 0;
+    uint64_t max = 0;
+
+    memset(out, 0, sizeof(*out));
+    out->queues = count;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (index[i] < 0)
+            continue;
+
+        uint64_t cur = data[index[i]];
+        uint64_t d = primed && cur >= prev[i] ? cur - prev[i] : 0;
+
+        prev[i] = cur;
+        total += d;
+        if (d > max)
+        {
+            max = d;
+            out->busiest = i;
+        }
+    }
+
+    out->pps = elapsed > 0 ? total * 1000 / elapsed : 0;
+    if (count > 1 && total && out->pps >= QUEUE_MIN_PPS)
+        out->imbalance = (int)((max * count - total) * 1000 / (total * (count - 1)));
+}
+
+int queues_sample(QUEUE_STATS *q, const char *ifname, long elapsed, QUEUE_BALANCE *rx, QUEUE_BALANCE *tx)
+{
+    int n = stats_count(ifname);
+
+    if (n < 0 || (n != q->n_stats && discover(q, ifname, n) < 0))
+    {
+        // Gone, renamed or without ethtool statistics; start over when it's back
+        q->n_stats = -1;
+        return -1;
+    }
+
+    struct ethtool_stats *es = q->stats;
+    es->cmd = ETHTOOL_GSTATS;
+    es->n_stats = n;
+    if (n && eth_ioctl(ifname, es) < 0)
+    {
+        q->n_stats = -1;
+        return -1;
+    }
+
+    balance(es->data, q->rx_index, q->rx_prev, q->rx_count, q->primed, elapsed, rx);
+    balance(es->data, q->tx_index, q->tx_prev, q->tx_count, q->primed, elapsed, tx);
+    q->primed = 1;
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef QUEUES_H
+#define QUEUES_H
+
+#include <stdint.h>
+
+#define QUEUE_MAX 32
+#define QUEUE_MIN_PPS 1000 // below this the split between queues is noise
+
+typedef struct
+{
+    int queues;    // queues with a packet counter, 0 when the driver has none
+    int busiest;   // index of the queue that took the most packets
+    int imbalance; // permille: 0 evenly spread, 1000 all on one queue
+    uint64_t pps;
+} QUEUE_BALANCE;
+
+// Per-queue packet counters from the driver's ethtool statistics. Which
+// entries are per-queue counters is worked out from their names once, and
+// again whenever the driver changes its statistics set.
+typedef struct
+{
+    int n_stats;
+    int rx_index[QUEUE_MAX];
+    int tx_index[QUEUE_MAX];
+    int rx_count;
+    int tx_count;
+    uint64_t rx_prev[QUEUE_MAX];
+    uint64_t tx_prev[QUEUE_MAX];
+    int primed;
+    void *stats; // struct ethtool_stats sized for n_stats
+} QUEUE_STATS;
+
+QUEUE_STATS *queues_create(void);
+void queues_free(QUEUE_STATS *q);
+int queues_sample(QUEUE_STATS *q, const char *ifname, long elapsed, QUEUE_BALANCE *rx, QUEUE_BALANCE *tx);
+
+#endif
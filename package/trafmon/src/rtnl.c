@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+
+#include "rtnl.h"
+
+#define RTNL_BUF 32768
+
+static int rtnl_fd = -1;
+static int rtnl_mon_fd = -1;
+static uint32_t rtnl_seq;
+
+// Replies are parsed in place; one buffer serves every request
+static union
+{
+    struct nlmsghdr h;
+    char buf[RTNL_BUF];
+} rtnl_rx;
+
+// Notifications get their own buffer so callbacks may issue requests
+static union
+{
+    struct nlmsghdr h;
+    char buf[RTNL_BUF / 4];
+} rtnl_mon_rx;
+
+int rtnl_open(void)
+{
+    if (rtnl_fd >= 0)
+        return 0;
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+        return -1;
+
+    struct sockaddr_nl sa = {.nl_family = AF_NETLINK};
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Never let a lost reply wedge the sampling loop
+    struct timeval tv = {.tv_sec = 1};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    rtnl_fd = fd;
+    return 0;
+}
+
+void rtnl_close(void)
+{
+    if (rtnl_fd >= 0)
+        close(rtnl_fd);
+    rtnl_fd = -1;
+}
+
+int rtnl_parse_link(const struct nlmsghdr *nlh, LINK_STATS *st)
+{
+    if (nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK)
+        return -1;
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+        return -1;
+
+    const struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    int len = nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*ifi));
+    int carrier = -1;
+
+    // A port leaving a bridge also sends an AF_BRIDGE DELLINK; the link itself stays
+    if (ifi->ifi_family != AF_UNSPEC)
+        return -1;
+
+    memset(st, 0, sizeof(*st));
+    st->ifindex = ifi->ifi_index;
+    st->flags = ifi->ifi_flags;
+    st->removed = nlh->nlmsg_type == RTM_DELLINK;
+
+    for (const struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+    {
+        switch (rta->rta_type)
+        {
+        case IFLA_IFNAME:
+            snprintf(st->ifname, sizeof(st->ifname), "%s", (const char *)RTA_DATA(rta));
+            break;
+        case IFLA_CARRIER:
+            carrier = *(const uint8_t *)RTA_DATA(rta);
+            break;
+        case IFLA_MASTER:
+            st->master = *(const uint32_t *)RTA_DATA(rta);
+            break;
+        case IFLA_STATS64:
+        {
+            struct rtnl_link_stats64 s;
+            size_t n = RTA_PAYLOAD(rta);
+
+            memset(&s, 0, sizeof(s));
+            memcpy(&s, RTA_DATA(rta), n < sizeof(s) ? n : sizeof(s));
+            st->rx_bytes = s.rx_bytes;
+            st->tx_bytes = s.tx_bytes;
+            st->rx_packets = s.rx_packets;
+            st->tx_packets = s.tx_packets;
+            st->rx_dropped = s.rx_dropped;
+            st->tx_dropped = s.tx_dropped;
+            st->rx_errors = s.rx_errors;
+            st->tx_errors = s.tx_errors;
+            st->rx_missed_errors = s.rx_missed_errors;
+            st->rx_fifo_errors = s.rx_fifo_errors;
+            st->rx_over_errors = s.rx_over_errors;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (carrier < 0)
+        carrier = (st->flags & IFF_LOWER_UP) != 0;
+    // Match sysfs, which reports no carrier for an administratively down link
+    st->carrier = (st->flags & IFF_UP) && carrier;
+    return 0;
+}
+
+static int rtnl_recv(uint32_t seq, LINK_STATS *one, rtnl_link_cb cb, void *arg)
+{
+    for (;;)
+    {
+        ssize_t n = recv(rtnl_fd, rtnl_rx.buf, sizeof(rtnl_rx.buf), 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        int len = (int)n;
+        for (struct nlmsghdr *nlh = &rtnl_rx.h; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+        {
+            if (nlh->nlmsg_seq != seq)
+                continue;
+
+            if (nlh->nlmsg_type == NLMSG_DONE)
+                return 0;
+
+            if (nlh->nlmsg_type == NLMSG_ERROR)
+            {
+                const struct nlmsgerr *err = NLMSG_DATA(nlh);
+                if (err->error == 0)
+                    return 0;
+                errno = -err->error;
+                return -1;
+            }
+
+            LINK_STATS st;
+            if (rtnl_parse_link(nlh, one ? one : &st) < 0)
+                continue;
+
+            if (one)
+                return 0;
+            cb(&st, arg);
+        }
+    }
+}
+
+int rtnl_get_link(const char *ifname, int ifindex, LINK_STATS *st)
+{
+    struct
+    {
+        struct nlmsghdr nlh;
+        struct ifinfomsg ifi;
+        char attrs[RTA_SPACE(IFNAMSIZ)];
+    } req;
+
+    if (rtnl_fd < 0 && rtnl_open() < 0)
+        return -1;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
+    req.nlh.nlmsg_type = RTM_GETLINK;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST;
+    req.nlh.nlmsg_seq = ++rtnl_seq;
+    req.ifi.ifi_family = AF_UNSPEC;
+    req.ifi.ifi_index = ifindex;
+
+    if (ifindex <= 0)
+    {
+        size_t n = strnlen(ifname, IFNAMSIZ - 1);
+        struct rtattr *rta = (struct rtattr *)((char *)&req + NLMSG_ALIGN(req.nlh.nlmsg_len));
+
+        rta->rta_type = IFLA_IFNAME;
+        rta->rta_len = RTA_LENGTH(n + 1);
+        memcpy(RTA_DATA(rta), ifname, n);
+        req.nlh.nlmsg_len = NLMSG_ALIGN(req.nlh.nlmsg_len) + RTA_ALIGN(rta->rta_len);
+    }
+
+    if (send(rtnl_fd, &req, req.nlh.nlmsg_len, 0) < 0)
+        return -1;
+
+    return rtnl_recv(req.nlh.nlmsg_seq, st, NULL, NULL);
+}
+
+int rtnl_dump_links(rtnl_link_cb cb, void *arg)
+{
+    struct
+    {
+        struct nlmsghdr nlh;
+        struct ifinfomsg ifi;
+    } req;
+
+    if (rtnl_fd < 0 && rtnl_open() < 0)
+        return -1;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
+    req.nlh.nlmsg_type = RTM_GETLINK;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = ++rtnl_seq;
+    req.ifi.ifi_family = AF_UNSPEC;
+
+    if (send(rtnl_fd, &req, req.nlh.nlmsg_len, 0) < 0)
+        return -1;
+
+    return rtnl_recv(req.nlh.nlmsg_seq, NULL, cb, arg);
+}
+
+int rtnl_monitor_open(void)
+{
+    if (rtnl_mon_fd >= 0)
+        return rtnl_mon_fd;
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (fd < 0)
+        return -1;
+
+    struct sockaddr_nl sa = {.nl_family = AF_NETLINK, .nl_groups = RTMGRP_LINK};
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    rtnl_mon_fd = fd;
+    return fd;
+}
+
+void rtnl_monitor_close(void)
+{
+    if (rtnl_mon_fd >= 0)
+        close(rtnl_mon_fd);
+    rtnl_mon_fd = -1;
+}
+
+// Drain pending link notifications. Fails with ENOBUFS when the kernel
+// dropped events, after which the caller has to resynchronise its state.
+int rtnl_monitor_read(rtnl_link_cb cb, void *arg)
+{
+    int events = 0;
+
+    for (;;)
+    {
+        ssize_t n = recv(rtnl_mon_fd, rtnl_mon_rx.buf, sizeof(rtnl_mon_rx.buf), 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return events;
+            return -1;
+        }
+
+        int len = (int)n;
+        for (struct nlmsghdr *nlh = &rtnl_mon_rx.h; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len))
+        {
+            LINK_STATS st;
+            if (rtnl_parse_link(nlh, &st) < 0)
+                continue;
+            cb(&st, arg);
+            events++;
+        }
+    }
+}
+
+// Packets the box failed to handle: stack drops plus the NIC running out of
+// ring or FIFO space, which rx_dropped alone doesn't show on most drivers
+uint64_t link_drops(const LINK_STATS *st)
+{
+    return st->rx_dropped + st->tx_dropped + st->rx_missed_errors + st->rx_fifo_errors + st->rx_over_errors;
+}
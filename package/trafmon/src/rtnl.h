@@ -0,0 +1,45 @@
+#ifndef RTNL_H
+#define RTNL_H
+
+#include <stdint.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP 0x10000
+#endif
+
+typedef struct
+{
+    int ifindex;
+    char ifname[IFNAMSIZ];
+    unsigned int flags;
+    int carrier;
+    int removed;
+    int master; // ifindex of the bridge/bond this link is enslaved to, or 0
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint64_t rx_dropped;
+    uint64_t tx_dropped;
+    uint64_t rx_errors;
+    uint64_t tx_errors;
+    uint64_t rx_missed_errors;
+    uint64_t rx_fifo_errors;
+    uint64_t rx_over_errors;
+} LINK_STATS;
+
+typedef void (*rtnl_link_cb)(const LINK_STATS *st, void *arg);
+
+int rtnl_open(void);
+void rtnl_close(void);
+int rtnl_get_link(const char *ifname, int ifindex, LINK_STATS *st);
+int rtnl_dump_links(rtnl_link_cb cb, void *arg);
+int rtnl_parse_link(const struct nlmsghdr *nlh, LINK_STATS *st);
+int rtnl_monitor_open(void);
+void rtnl_monitor_close(void);
+int rtnl_monitor_read(rtnl_link_cb cb, void *arg);
+uint64_t link_drops(const LINK_STATS *st);
+
+#endif
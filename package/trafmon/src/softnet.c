@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hgledon.h"
+#include "softnet.h"
+
+#define SOFTNET_LINE_MAX 160 // 15 hex columns on current kernels, with room to grow
+#define SOFTNET_CPU_FIELD 12 // column with the cpu index since 5.10; older kernels go by line
+
+static int softnet_open(SOFTNET *sn)
+{
+    char path[256];
+
+    hgl_path(path, sizeof(path), SOFTNET_PATH);
+    sn->fd = open(path, O_RDONLY | O_CLOEXEC);
+    return sn->fd < 0 ? -1 : 0;
+}
+
+SOFTNET *softnet_create(void)
+{
+    SOFTNET *sn = calloc(1, sizeof(*sn));
+
+    if (!sn)
+        return NULL;
+
+    // A missing file is retried on every read
+    softnet_open(sn);
+    return sn;
+}
+
+void softnet_free(SOFTNET *sn)
+{
+    if (!sn)
+        return;
+    if (sn->fd >= 0)
+        close(sn->fd);
+    free(sn);
+}
+
+static const char *parse_hex(const char *p, const char *end, uint32_t *v)
+{
+    uint32_t x = 0;
+
+    while (p < end && *p == ' ')
+        p++;
+
+    const char *start = p;
+    for (; p < end; p++)
+    {
+        unsigned int c = (unsigned char)*p;
+
+        if (c - '0' < 10)
+            x = x << 4 | (c - '0');
+        else if ((c | 0x20) - 'a' < 6)
+            x = x << 4 | ((c | 0x20) - 'a' + 10);
+        else
+            break;
+    }
+
+    *v = x;
+    return p == start ? NULL : p;
+}
+
+// Re-read every core's counters; the previous ones are kept for softnet_worst
+int softnet_read(SOFTNET *sn)
+{
+    static char buf[SOFTNET_MAX_CPUS * SOFTNET_LINE_MAX];
+    size_t len = 0;
+
+    if (sn->fd < 0 && softnet_open(sn) < 0)
+        return -1;
+
+    // seq_file restarts at offset 0, so the fd never needs a seek or a reopen
+    while (len < sizeof(buf))
+    {
+        ssize_t n = pread(sn->fd, buf + len, sizeof(buf) - len, len);
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        len += n;
+    }
+
+    memcpy(sn->prev, sn->cur, sizeof(sn->prev));
+    memcpy(sn->prev_seen, sn->seen, sizeof(sn->prev_seen));
+    memset(sn->seen, 0, sizeof(sn->seen));
+
+    const char *end = buf + len;
+    int line = 0;
+
+    for (const char *p = buf; p < end; line++)
+    {
+        const char *eol = memchr(p, '\n', end - p);
+        uint32_t field[SOFTNET_CPU_FIELD + 1];
+        int nf = 0;
+
+        if (!eol)
+            break; // a cut-off last line, only if the buffer ran out
+        while (nf <= SOFTNET_CPU_FIELD && (p = parse_hex(p, eol, &field[nf])) != NULL)
+            nf++;
+        p = eol + 1;
+
+        int cpu = nf > SOFTNET_CPU_FIELD ? (int)field[SOFTNET_CPU_FIELD] : line;
+        if (nf < 3 || cpu >= SOFTNET_MAX_CPUS)
+            continue;
+
+        sn->cur[cpu].processed = field[0];
+        sn->cur[cpu].dropped = field[1];
+        sn->cur[cpu].squeezed = field[2];
+        sn->seen[cpu] = 1;
+    }
+
+    return line ? 0 : -1;
+}
+
+// The counters are 32 bits wide and wrap, which the unsigned difference
+// absorbs. Rounded up, so a single event in a long tick still shows.
+static uint64_t per_second(uint32_t delta, long elapsed)
+{
+    return ((uint64_t)delta * 1000 + elapsed - 1) / elapsed;
+}
+
+// The core that is dropping, else the one squeezed most, else the busiest.
+// Cores that came or went between the two reads are left out.
+int softnet_worst(const SOFTNET *sn, long elapsed, SOFTNET_RATE *out)
+{
+    int found = 0;
+
+    if (elapsed <= 0)
+        return -1;
+
+    for (int i = 0; i < SOFTNET_MAX_CPUS; i++)
+    {
+        if (!sn->seen[i] || !sn->prev_seen[i])
+            continue;
+
+        SOFTNET_RATE r = {
+            .cpu = i,
+            .processed = per_second(sn->cur[i].processed - sn->prev[i].processed, elapsed),
+            .dropped = per_second(sn->cur[i].dropped - sn->prev[i].dropped, elapsed),
+            .squeezed = per_second(sn->cur[i].squeezed - sn->prev[i].squeezed, elapsed),
+        };
+
+        if (!found || r.dropped > out->dropped ||
+            (r.dropped == out->dropped &&
+             (r.squeezed > out->squeezed || (r.squeezed == out->squeezed && r.processed > out->processed))))
+            *out = r;
+        found = 1;
+    }
+
+    return found ? 0 : -1;
+}
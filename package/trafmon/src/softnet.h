@@ -0,0 +1,42 @@
+#ifndef SOFTNET_H
+#define SOFTNET_H
+
+#include <stdint.h>
+
+#define SOFTNET_PATH "/proc/net/softnet_stat"
+#define SOFTNET_NAME "softnet" // stands in for the ifname of a softnet binding
+#define SOFTNET_MAX_CPUS 64
+
+typedef struct
+{
+    uint32_t processed;
+    uint32_t dropped;  // backlog full
+    uint32_t squeezed; // NET_RX ran out of budget or time with work left
+} SOFTNET_CPU;
+
+// Per-second rates of the core under the most pressure
+typedef struct
+{
+    int cpu;
+    uint64_t processed;
+    uint64_t dropped;
+    uint64_t squeezed;
+} SOFTNET_RATE;
+
+// softnet_stat held open and re-read in place: one pread per sample, parsed
+// into fixed arrays without allocating
+typedef struct
+{
+    int fd;
+    SOFTNET_CPU cur[SOFTNET_MAX_CPUS];
+    SOFTNET_CPU prev[SOFTNET_MAX_CPUS];
+    unsigned char seen[SOFTNET_MAX_CPUS];
+    unsigned char prev_seen[SOFTNET_MAX_CPUS];
+} SOFTNET;
+
+SOFTNET *softnet_create(void);
+void softnet_free(SOFTNET *sn);
+int softnet_read(SOFTNET *sn);
+int softnet_worst(const SOFTNET *sn, long elapsed, SOFTNET_RATE *out);
+
+#endif
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hgledon.h"
+#include "stats.h"
+#include "ctl.h"
+
+#define STATS_RETRIES 100
+
+// Build the file under a temporary name so readers never map a half-written header
+STATS_SHM *stats_create(const char *path, int count)
+{
+    char tmp[128];
+    size_t size = sizeof(STATS_SHM) + (size_t)count * sizeof(STATS_SLOT);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return NULL;
+
+    if (ftruncate(fd, size) < 0)
+    {
+        close(fd);
+        unlink(tmp);
+        return NULL;
+    }
+
+    STATS_SHM *shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED)
+    {
+        unlink(tmp);
+        return NULL;
+    }
+
+    shm->magic = STATS_MAGIC;
+    shm->count = count;
+    shm->size = size;
+    shm->pid = getpid();
+
+    if (rename(tmp, path) < 0)
+    {
+        munmap(shm, size);
+        unlink(tmp);
+        return NULL;
+    }
+
+    return shm;
+}
+
+void stats_destroy(const char *path, STATS_SHM *shm)
+{
+    if (!shm)
+        return;
+
+    unlink(path);
+    munmap(shm, shm->size);
+}
+
+STATS_SHM *stats_open(const char *path)
+{
+    struct stat sb;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &sb) < 0 || (size_t)sb.st_size < sizeof(STATS_SHM))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    STATS_SHM *shm = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED)
+        return NULL;
+
+    if (shm->magic != STATS_MAGIC || shm->size != (uint64_t)sb.st_size ||
+        shm->size < sizeof(STATS_SHM) + shm->count * sizeof(STATS_SLOT))
+    {
+        munmap(shm, sb.st_size);
+        return NULL;
+    }
+
+    return shm;
+}
+
+void stats_close(STATS_SHM *shm)
+{
+    if (shm)
+        munmap(shm, shm->size);
+}
+
+// Map the rings of every running daemon in turn; returns how many were read
+int stats_foreach(stats_cb cb, void *arg)
+{
+    char dir[128];
+    struct dirent *entry;
+    int count = 0;
+
+    hgl_path(dir, sizeof(dir), RUN_DIR);
+    DIR *d = opendir(dir);
+    if (!d)
+        return 0;
+
+    while ((entry = readdir(d)) != NULL)
+    {
+        char path[128];
+        size_t len = strlen(entry->d_name);
+
+        if (len < 7 || strcmp(entry->d_name + len - 6, ".stats") != 0)
+            continue;
+
+        if (hgl_path(path, sizeof(path), RUN_DIR "/%s", entry->d_name) < 0)
+            continue;
+        STATS_SHM *shm = stats_open(path);
+        if (!shm)
+            continue;
+
+        // Left behind by a daemon that died without cleaning up
+        if (kill(shm->pid, 0) < 0 && errno == ESRCH)
+        {
+            stats_close(shm);
+            unlink(path);
+            continue;
+        }
+
+        count++;
+        cb(shm, arg);
+        stats_close(shm);
+    }
+
+    closedir(d);
+    return count;
+}
+
+void stats_push(STATS_SLOT *slot, const STATS_SAMPLE *s)
+{
+    uint32_t seq = slot->seq;
+
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->ring[slot->head % STATS_RING] = *s;
+    __atomic_store_n(&slot->head, slot->head + 1, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Copy up to max of the newest samples, oldest first; returns how many were read
+int stats_read(const STATS_SLOT *slot, STATS_SAMPLE *out, int max)
+{
+    if (max > STATS_RING)
+        max = STATS_RING;
+
+    for (int tries = 0; tries < STATS_RETRIES; tries++)
+    {
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue;
+
+        uint32_t head = __atomic_load_n(&slot->head, __ATOMIC_RELAXED);
+        int n = head < (uint32_t)max ? (int)head : max;
+
+        for (int i = 0; i < n; i++)
+            out[i] = slot->ring[(head - n + i) % STATS_RING];
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq)
+            return n;
+    }
+
+    return -1;
+}
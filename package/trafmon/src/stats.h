@@ -0,0 +1,75 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <net/if.h>
+
+#define STATS_MAGIC 0x544d5333 // "TMS3"
+#define STATS_RING 64
+
+// What a binding follows; says how to read the rate fields of its samples
+typedef enum
+{
+    STATS_SOURCE_LINK,
+    STATS_SOURCE_SOFTNET, // pps, drop_rate and error_rate (squeezes) of the busiest core
+    STATS_SOURCE_CONNTRACK
+} stats_source_t;
+
+// One published sample; timestamp is CLOCK_MONOTONIC in ms
+typedef struct
+{
+    uint64_t timestamp;
+    uint64_t rx_bps;
+    uint64_t tx_bps;
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint32_t carrier;
+    uint32_t led_state;
+    uint64_t pps;
+    uint64_t drop_rate;
+    uint64_t error_rate;
+    int32_t rxq_count; // queue balance, see QUEUE_BALANCE
+    int32_t rxq_imbalance;
+    int32_t rxq_busiest;
+    int32_t txq_count;
+    int32_t txq_imbalance;
+    int32_t txq_busiest;
+    uint32_t offload; // the kernel LED trigger blinks, led_state is stale
+    int32_t busy_cpu; // softnet: the core under the most pressure
+    uint32_t source;  // stats_source_t
+    uint64_t ct_count; // conntrack: entries, table size (or ceiling), failed inserts/s
+    uint64_t ct_max;
+    uint64_t ct_failed;
+} STATS_SAMPLE;
+
+// Per-binding ring, guarded by a seqlock: seq is odd while the daemon writes
+typedef struct
+{
+    uint32_t seq;
+    uint32_t head;
+    char name[32];
+    char ifname[IFNAMSIZ];
+    char led[16];
+    STATS_SAMPLE ring[STATS_RING];
+} STATS_SLOT;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t count;
+    uint32_t size;
+    int32_t pid;
+    STATS_SLOT slots[];
+} STATS_SHM;
+
+STATS_SHM *stats_create(const char *path, int count);
+void stats_destroy(const char *path, STATS_SHM *shm);
+typedef void (*stats_cb)(const STATS_SHM *shm, void *arg);
+
+STATS_SHM *stats_open(const char *path);
+void stats_close(STATS_SHM *shm);
+int stats_foreach(stats_cb cb, void *arg);
+void stats_push(STATS_SLOT *slot, const STATS_SAMPLE *s);
+int stats_read(const STATS_SLOT *slot, STATS_SAMPLE *out, int max);
+
+#endif
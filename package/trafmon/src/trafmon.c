@@ -7,28 +7,57 @@
 #include <time.h>
 #include <fcntl.h>
 #include <signal.h>
-#include <syslog.h>
 #include <math.h>
+#include <errno.h>
+#include <limits.h>
 
 #include <sys/stat.h>
-#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #include "hgledon.h"
+#include "rtnl.h"
+#include "config.h"
+#include "stats.h"
+#include "ctl.h"
+#include "history.h"
+#include "log.h"
+#include "pwm.h"
+#include "group.h"
+#include "softnet.h"
+#include "conntrack.h"
+#include "queues.h"
+#include "netattr.h"
 
 #define IDLE_TIMEOUT 1000
-#define TRAFFIC_THRESHOLD 10
+#define TRAFFIC_THRESHOLD (10 * KB * 1000 / MAX_VAL) // bytes/s, 10 KB per tick
 #define MIN_BLINK_DELAY 50
 #define MAX_BLINK_DELAY 150
 #define MAX_VAL 100
 #define MAX_BUF 64
 #define KB 1024
+#define OFFLOAD_PERIOD 3000
+#define IDLE_PERIOD 1500
+#define IDLE_BACKOFF_AFTER 10000
+#define DEFAULT_SMOOTHING 300
+#define DEFAULT_CEILING 1000 // Mbit/s, when the link speed is unknown
+#define LOAD_STEPS 1000      // load is expressed in permille of capacity
+#define HISTORY_MAX_ROWS 120
+#define LATENCY_BUCKETS 8
+#define PWM_MIN_DUTY 50 // permille; an idle link still glows
+#define OVERLOAD_HOLD 3000 // ms 'warn' outlasts the last overloaded sample
+#define SOFTNET_IDLE_PPS 100       // below this the busiest core counts as idle
+#define SOFTNET_DEFAULT_KPPS 100   // per-core ceiling for softnet bindings
+#define CONNTRACK_BUSY_LOAD 250    // permille of the table; below it the LED stays on
+#define CONNTRACK_FULL_LOAD 900
 
 volatile int running = 1;
+volatile int dump_requested;
+volatile int reload_requested;
 char interface_name[32];
-char log_buf[256];
-char lock_file_path[64];
-char iface_file_path[64];
 char led_name[16] = "lan";
+GLOBAL_CONF globals = {.log_rate = -1, .log_burst = -1, .log_ring = -1};
+const char *config_path; // set when the daemon runs from a config, so it can reload
 
 typedef enum
 {
@@ -38,123 +67,235 @@ typedef enum
     OFF_ON
 } Pattern;
 
+typedef enum
+{
+    CURVE_LOG,
+    CURVE_LINEAR,
+    CURVE_STEPPED,
+    CURVE_COUNT
+} curve_t;
+
 typedef enum
 {
     LED_STATE_UNKNOWN,
     LED_STATE_OFF,
     LED_STATE_ON,
-    LED_STATE_BLINK
+    LED_STATE_BLINK,
+    LED_STATE_PWM,
+    LED_STATE_WARN
 } led_state_t;
 
-static led_state_t last_led_state = LED_STATE_UNKNOWN;
-
-void set_file_paths(const char *iface)
+typedef struct
 {
-    snprintf(lock_file_path, sizeof(lock_file_path), "/var/run/trafmon_%s.lock", iface);
-    snprintf(iface_file_path, sizeof(iface_file_path), "/var/run/trafmon_%s.iface", iface);
-}
+    Pattern pattern;
+    int frame;
+    int first_ms;
+    int second_ms;
+    int repeat;
+    long deadline;
+} ANIMATION;
+
+typedef struct
+{
+    char name[32];
+    char ifname[IFNAMSIZ];
+    char cur_name[IFNAMSIZ];
+    char led[16];
+    int ifindex;
+    int carrier;
+    int up;
+    int sampled;
+    int primed;
+    LINK_STATS st;
+    uint64_t prev_rx;
+    uint64_t prev_tx;
+    long last_activity_time;
+    led_state_t led_state;
+    int lb_rate;
+    int lb_pattern;
+    ANIMATION anim;
+    int offload;
+    char sysfs_led[64];
+    char sysfs_led_off[64];
+    LED_CLASS lc;
+    LED_CLASS lc_off;
+    long last_sample_time;
+    long last_delta_time;
+    int smoothing;
+    uint64_t rx_bps;
+    uint64_t tx_bps;
+    uint64_t rate_bps;
+    curve_t curve;
+    int ceiling;
+    uint64_t capacity;
+    int capacity_members; // group members the capacity was summed over
+    int load;
+    int stopped;
+    HISTORY *hist;
+    int brightness;
+    PWM_CHANNEL *pwm; // heap-held: the thread must not see it move with the array
+    IF_GROUP *group;  // set when the binding sums several interfaces
+    int overload;     // drops/s threshold, 0 disables
+    uint64_t prev_packets;
+    uint64_t prev_drops;
+    uint64_t prev_errors;
+    uint64_t pps;
+    uint64_t drop_rate;
+    uint64_t error_rate;
+    long overload_until;
+    SOFTNET *softnet; // set when the binding follows the cores, not a link
+    int busy_cpu;
+    CONNTRACK *conntrack; // set when it follows the conntrack table
+    uint64_t ct_count;
+    uint64_t ct_max; // the ceiling when one is set
+    uint64_t ct_failed; // inserts/s
+    QUEUE_STATS *queues;  // per-queue sampling of a single link
+    QUEUE_BALANCE rxq;
+    QUEUE_BALANCE txq;
+    int imbalance; // percent, 0 leaves the LED alone
+    int imbalanced;
+    NET_ATTRS attrs; // sysfs path, when rtnetlink is unavailable
+} BINDING;
+
+static const char *curve_names[CURVE_COUNT] = {"log", "linear", "stepped"};
+static unsigned char curve_tables[CURVE_COUNT][LOAD_STEPS + 1];
+
+static const char *pattern_states[][2] = {
+    [DIS_ON] = {"dis", "on"},
+    [DIS_OFF] = {"dis", "off"},
+    [ON_OFF] = {"on", "off"},
+    [OFF_ON] = {"off", "on"},
+};
+
+static BINDING *bindings;
+static int binding_count;
+static int use_rtnl;
+static int mon_fd = -1;
+static STATS_SHM *stats_shm;
+static int ctl_fd = -1;
+static char stats_path[128];
+static int sample_drops; // any binding watches for overload, so sysfs reads the drop counters too
+
+// Always-on, plain increments; read out with SIGUSR1 or 'trafmon counters'
+typedef struct
+{
+    unsigned long ticks;
+    unsigned long overruns;
+    unsigned long wakeups;
+    unsigned long latency[LATENCY_BUCKETS];
+    unsigned long sysfs_reads;
+    unsigned long rtnl_requests;
+    unsigned long led_transitions;
+    unsigned long blink_calls;
+    unsigned long long blink_ns;
+} COUNTERS;
+
+static COUNTERS counters;
+static const int latency_limits_us[LATENCY_BUCKETS - 1] = {100, 500, 1000, 2000, 5000, 10000, 50000};
+
+static const char *led_state_names[] = {"unknown", "off", "on", "blink", "pwm", "warn"};
+
+// One running binding as reported over the control socket
+typedef struct
+{
+    char name[32];
+    char ifname[IFNAMSIZ];
+    char led[16];
+    int pid;
+} INSTANCE_INFO;
 
-bool parse_iface(const char *filename, char *iface, size_t size)
+typedef struct
 {
-    const char *prefix = "trafmon_";
-    const char *suffix = ".lock";
+    INSTANCE_INFO *v;
+    int count;
+} INSTANCE_LIST;
 
-    size_t len = strlen(filename);
-    size_t prefix_len = strlen(prefix);
-    size_t suffix_len = strlen(suffix);
+int is_valid_led(const char *led)
+{
+    return strcmp(led, "lan") == 0 || strcmp(led, "power") == 0;
+}
 
-    if (len <= prefix_len + suffix_len)
-        return false;
-    if (strncmp(filename, prefix, prefix_len) != 0)
-        return false;
-    if (strcmp(filename + len - suffix_len, suffix) != 0)
-        return false;
+// Response lines after "OK": name ifname led pid
+void collect_instances(const char *resp, void *arg)
+{
+    INSTANCE_LIST *list = arg;
 
-    size_t iface_len = len - prefix_len - suffix_len;
-    if (iface_len >= size)
-        return false;
+    if (strncmp(resp, "OK", 2) != 0)
+        return;
 
-    memcpy(iface, filename + prefix_len, iface_len);
-    iface[iface_len] = '\0';
-    return true;
+    for (const char *line = strchr(resp, '\n'); line && *++line; line = strchr(line, '\n'))
+    {
+        char buf[128];
+        size_t len = strcspn(line, "\n");
+        INSTANCE_INFO info = {0};
+
+        if (len >= sizeof(buf))
+            continue;
+        memcpy(buf, line, len);
+        buf[len] = '\0';
+
+        if (sscanf(buf, "%31s %15s %15s %d", info.name, info.ifname, info.led, &info.pid) != 4)
+            continue;
+
+        INSTANCE_INFO *tmp = realloc(list->v, (list->count + 1) * sizeof(*tmp));
+        if (!tmp)
+            return;
+        list->v = tmp;
+        list->v[list->count++] = info;
+    }
 }
 
-int is_valid_led(const char *led)
+// Ask every running daemon; the caller frees list->v
+void query_instances(const char *req, INSTANCE_LIST *list)
 {
-    return strcmp(led, "lan") == 0 || strcmp(led, "power") == 0;
+    list->v = NULL;
+    list->count = 0;
+    ctl_foreach(req, collect_instances, list);
 }
 
 int is_led_in_use(const char *target_led)
 {
-    DIR *d = opendir("/var/run");
-    struct dirent *entry;
-
-    if (!d)
-        return 0;
+    INSTANCE_LIST list;
+    int used = 0;
 
-    while ((entry = readdir(d)) != NULL)
+    query_instances("list", &list);
+    for (int i = 0; i < list.count; i++)
     {
-        char iface[32];
-        if (parse_iface(entry->d_name, iface, sizeof(iface)))
-        {
-            char led_path[64];
-            snprintf(led_path, sizeof(led_path), "/var/run/trafmon_%s.iface", iface);
-
-            FILE *f = fopen(led_path, "r");
-            if (f)
-            {
-                char read_iface[32], used_led[16];
-                if (fscanf(f, "%31s %15s", read_iface, used_led) == 2)
-                {
-                    if (strcmp(used_led, target_led) == 0)
-                    {
-                        fclose(f);
-                        closedir(d);
-                        return 1;
-                    }
-                }
-                fclose(f);
-            }
-        }
+        if (strcmp(list.v[i].led, target_led) == 0)
+            used = 1;
     }
 
-    closedir(d);
-    return 0;
+    free(list.v);
+    return used;
 }
 
-int list_instances()
+int check_running(const char *iface)
 {
-    DIR *d = opendir("/var/run");
-    if (!d)
-    {
-        perror("Failed to open /var/run");
-        return EXIT_FAILURE;
-    }
+    char req[CTL_MAX_REQ];
+    INSTANCE_LIST list;
 
-    struct dirent *entry;
-    int found = 0;
+    snprintf(req, sizeof(req), "list %s", iface);
+    query_instances(req, &list);
+    free(list.v);
+    return list.count > 0;
+}
 
-    while ((entry = readdir(d)) != NULL)
-    {
-        char iface[32];
-        if (parse_iface(entry->d_name, iface, sizeof(iface)))
-        {
-            if (!found)
-            {
-                printf("Running trafmon instances:\n");
-                found = 1;
-            }
-            printf(" - %s\n", iface);
-        }
-    }
-    closedir(d);
+int list_instances()
+{
+    INSTANCE_LIST list;
 
-    if (!found)
+    query_instances("list", &list);
+    if (!list.count)
     {
         printf("No running trafmon instances found.\n");
         return EXIT_FAILURE;
     }
 
+    printf("Running trafmon instances:\n");
+    for (int i = 0; i < list.count; i++)
+        printf(" - %s (LED: %s, PID: %d)\n", list.v[i].ifname, list.v[i].led, list.v[i].pid);
+
+    free(list.v);
     return EXIT_SUCCESS;
 }
 
@@ -163,50 +304,17 @@ void stop_daemon(int)
     running = 0;
 }
 
-void log_msg(const char *msg)
+void request_dump(int)
 {
-    openlog("trafmon", LOG_PID | LOG_CONS, LOG_DAEMON);
-    syslog(LOG_INFO, "%s", msg);
-    closelog();
+    dump_requested = 1;
 }
 
-int check_iface(const char *iface)
+void request_reload(int)
 {
-    DIR *dir = opendir("/sys/class/net");
-    if (!dir)
-        return 0;
-
-    struct dirent *entry;
-    int found = 0;
-
-    while ((entry = readdir(dir)) != NULL)
-    {
-        if (strcmp(entry->d_name, iface) == 0)
-        {
-            found = 1;
-            break;
-        }
-    }
-    closedir(dir);
-
-    if (!found)
-        return 0;
-
-    char path[128];
-    snprintf(path, sizeof(path), "/sys/class/net/%s/carrier", iface);
-
-    FILE *f = fopen(path, "r");
-    if (!f)
-        return 0;
-
-    int carrier = 0;
-    fscanf(f, "%d", &carrier);
-    fclose(f);
-
-    return carrier == 1;
+    reload_requested = 1;
 }
 
-void led(const char *led_type, const char *state)
+GPIO_PINS *led_pins()
 {
     static GPIO_PINS pins;
     static char kernel_version[MAX_BUF];
@@ -217,8 +325,12 @@ void led(const char *led_type, const char *state)
         pins = init_gpio(kernel_version);
         initialized = 1;
     }
+    return &pins;
+}
 
-    hgl_exec(led_type, state, pins);
+void led(const char *led_type, const char *state)
+{
+    hgl_exec(led_type, state, *led_pins());
 }
 
 void sleep_ms(int milliseconds)
@@ -229,43 +341,11 @@ void sleep_ms(int milliseconds)
     nanosleep(&ts, NULL);
 }
 
-int check_running()
-{
-    FILE *file = fopen(lock_file_path, "r");
-    if (!file)
-        return 0;
-
-    int pid;
-    if (fscanf(file, "%d", &pid) != 1)
-    {
-        fclose(file);
-        return 0;
-    }
-    fclose(file);
-
-    return kill(pid, 0) == 0;
-}
-
-void create_lock_file()
-{
-    FILE *file = fopen(lock_file_path, "w");
-    if (file)
-    {
-        fprintf(file, "%d\n", getpid());
-        fclose(file);
-    }
-    file = fopen(iface_file_path, "w");
-    if (file)
-    {
-        fprintf(file, "%s %s\n", interface_name, led_name);
-        fclose(file);
-    }
-}
-
-void remove_lock_file()
+long monotonic_ms()
 {
-    remove(lock_file_path);
-    remove(iface_file_path);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
 }
 
 void redirect_stdio_to_null()
@@ -287,246 +367,313 @@ void redirect_stdio_to_null()
 void setup_signals()
 {
     signal(SIGCHLD, SIG_IGN);
-    signal(SIGHUP, SIG_IGN);
+    signal(SIGHUP, config_path ? request_reload : SIG_IGN);
     signal(SIGTERM, stop_daemon);
+    signal(SIGINT, stop_daemon);
+    signal(SIGUSR1, request_dump);
 }
 
 void select_led_for_instance()
 {
-    int lan_in_use = 0;
-    int power_in_use = 0;
-
-    DIR *d = opendir("/var/run");
-    struct dirent *entry;
-
-    if (d)
-    {
-        while ((entry = readdir(d)) != NULL)
-        {
-            char iface[32];
-            if (parse_iface(entry->d_name, iface, sizeof(iface)))
-            {
-                char led_path[64];
-                snprintf(led_path, sizeof(led_path), "/var/run/trafmon_%s.iface", iface);
-
-                FILE *f = fopen(led_path, "r");
-                if (f)
-                {
-                    char iface[32], used_led[16];
-                    if (fscanf(f, "%31s %15s", iface, used_led) == 2)
-                    {
-                        if (strcmp(used_led, "lan") == 0)
-                            lan_in_use = 1;
-                        if (strcmp(used_led, "power") == 0)
-                            power_in_use = 1;
-                    }
-                    fclose(f);
-                }
-            }
-        }
-        closedir(d);
-    }
-
-    if (!lan_in_use)
+    if (!is_led_in_use("lan"))
     {
         strncpy(led_name, "lan", sizeof(led_name));
     }
-    else if (!power_in_use)
+    else if (!is_led_in_use("power"))
     {
         strncpy(led_name, "power", sizeof(led_name));
     }
     else
     {
-        fprintf(stderr, "Maximum 2 trafmon instances supported (lan, power).\n");
+        fprintf(stderr, "No free LED left, both lan and power are in use.\n");
         exit(EXIT_FAILURE);
     }
 }
 
-void wait_for_interface(const char *iface)
+// "OK <pid> <bindings left>"; a daemon with nothing left exits on its own
+void on_stopped(const char *resp, void *arg)
 {
-    int wait_time = 10;
-    int total_wait = 0;
-    const int max_wait = 30;
+    int *found = arg;
+    int pid, remaining;
 
-    while (!check_iface(iface))
-    {
-        snprintf(log_buf, sizeof(log_buf),
-                 "Interface %s not found, waiting %d seconds...", iface, wait_time);
-        log_msg(log_buf);
+    if (sscanf(resp, "OK %d %d", &pid, &remaining) != 2)
+        return;
 
-        sleep(wait_time);
-        total_wait += wait_time;
-        wait_time = (wait_time + 10 > max_wait) ? max_wait : wait_time + 10;
-    }
+    (*found)++;
+    if (remaining)
+        return;
 
-    if (total_wait > 0)
-    {
-        snprintf(log_buf, sizeof(log_buf),
-                 "Interface %s found after waiting %d seconds.", iface, total_wait);
-        log_msg(log_buf);
-    }
-    else
-    {
-        snprintf(log_buf, sizeof(log_buf),
-                 "Interface %s found.", iface);
-        log_msg(log_buf);
-    }
+    printf("Stopping traffic monitor (PID: %d)...\n", pid);
+
+    // The daemon restores its LEDs on the way out
+    for (int i = 0; i < 10 && kill(pid, 0) == 0; i++)
+        sleep_ms(500);
+    if (kill(pid, 0) == 0)
+        kill(pid, SIGKILL);
 }
 
 int stop_process(const char *iface)
 {
-    set_file_paths(iface);
+    char req[CTL_MAX_REQ] = "stop";
+    int found = 0;
 
-    FILE *file = fopen(lock_file_path, "r");
-    if (!file)
-    {
-        printf("Traffic monitor for %s is not running.\n", iface);
-        return EXIT_FAILURE;
-    }
+    if (iface)
+        snprintf(req, sizeof(req), "stop %s", iface);
 
-    int pid;
-    if (fscanf(file, "%d", &pid) != 1)
+    ctl_foreach(req, on_stopped, &found);
+
+    if (!found)
     {
-        fclose(file);
-        printf("Failed to read PID from lock file for %s.\n", iface);
+        if (iface)
+            printf("Traffic monitor for %s is not running.\n", iface);
+        else
+            printf("No running trafmon instances found.\n");
         return EXIT_FAILURE;
     }
-    fclose(file);
 
-    if (kill(pid, SIGTERM) == 0)
-    {
-        printf("Stopping traffic monitor for %s (PID: %d)...\n", iface, pid);
+    log_write(LOG_INFO, LOG_CLASS_GENERAL, "Trafmon stopped.");
+    return EXIT_SUCCESS;
+}
 
-        for (int i = 0; i < 10; i++)
-        {
-            if (kill(pid, 0) == -1)
-            {
-                remove_lock_file();
-                sleep_ms(100);
-                led(led_name, "on");
-                log_msg("Trafmon stopped.");
-                return EXIT_SUCCESS;
-            }
-            sleep_ms(500);
-        }
+typedef struct
+{
+    const char *iface;
+    int found;
+} STATUS_QUERY;
 
-        kill(pid, SIGKILL);
-        remove_lock_file();
+// Straight from the daemon's mmap'd rings, so polling status never wakes it
+void print_status(const STATS_SHM *shm, void *arg)
+{
+    STATUS_QUERY *q = arg;
+
+    for (uint32_t i = 0; i < shm->count; i++)
+    {
+        const STATS_SLOT *slot = &shm->slots[i];
+        char ifname[sizeof(slot->ifname) + 1], led[sizeof(slot->led) + 1];
+        STATS_SAMPLE s;
+
+        // The names are rewritten in place on reload; never trust their terminator
+        snprintf(ifname, sizeof(ifname), "%.*s", (int)sizeof(slot->ifname), slot->ifname);
+        snprintf(led, sizeof(led), "%.*s", (int)sizeof(slot->led), slot->led);
+        if (!ifname[0] || (q->iface && strcmp(q->iface, ifname) != 0))
+            continue;
+
+        // A binding that hasn't completed a tick yet
+        if (stats_read(slot, &s, 1) != 1)
+            memset(&s, 0, sizeof(s));
+
+        const char *state = s.offload ? "offload"
+                            : s.led_state < sizeof(led_state_names) / sizeof(led_state_names[0])
+                                ? led_state_names[s.led_state]
+                                : "unknown";
+
+        q->found++;
+        printf("Traffic monitor is running (PID: %d), interface: %s, LED: %s\n", shm->pid, ifname, led);
+        printf("  RX: %llu KB/s, TX: %llu KB/s, RX packets: %llu, TX packets: %llu, link: %s, LED: %s\n",
+               (unsigned long long)(s.rx_bps / KB), (unsigned long long)(s.tx_bps / KB),
+               (unsigned long long)s.rx_packets, (unsigned long long)s.tx_packets, s.carrier ? "up" : "down", state);
+        if (s.source == STATS_SOURCE_CONNTRACK)
+            printf("  Entries: %llu of %llu, failed inserts: %llu/s\n", (unsigned long long)s.ct_count,
+                   (unsigned long long)s.ct_max, (unsigned long long)s.ct_failed);
+        else if (s.source == STATS_SOURCE_SOFTNET)
+            printf("  Busiest core: cpu%d, packets: %llu/s, drops: %llu/s, squeezes: %llu/s\n", s.busy_cpu,
+                   (unsigned long long)s.pps, (unsigned long long)s.drop_rate, (unsigned long long)s.error_rate);
+        else
+            printf("  Packets: %llu/s, drops: %llu/s, errors: %llu/s\n", (unsigned long long)s.pps,
+                   (unsigned long long)s.drop_rate, (unsigned long long)s.error_rate);
+        if (s.rxq_count > 1 || s.txq_count > 1)
+            printf("  Queues: rx %d, imbalance %d.%d%% (rx-%d busiest); tx %d, imbalance %d.%d%% (tx-%d busiest)\n",
+                   s.rxq_count, s.rxq_imbalance / 10, s.rxq_imbalance % 10, s.rxq_busiest, s.txq_count,
+                   s.txq_imbalance / 10, s.txq_imbalance % 10, s.txq_busiest);
     }
-    else
+}
+
+int check_status(const char *iface)
+{
+    STATUS_QUERY q = {iface, 0};
+
+    stats_foreach(print_status, &q);
+    if (!q.found)
     {
-        printf("Failed to send SIGTERM to %d, process may not exist.\n", pid);
-        remove_lock_file();
+        if (iface)
+            printf("Traffic monitor for %s is not running.\n", iface);
+        else
+            printf("No running trafmon instances found.\n");
         return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
 }
 
-int check_status(const char *iface)
+void on_led_set(const char *resp, void *arg)
+{
+    int *ok = arg;
+
+    if (strncmp(resp, "OK", 2) == 0)
+        *ok = 1;
+}
+
+int set_instance_led(const char *iface, const char *target_led)
 {
-    set_file_paths(iface);
+    char req[CTL_MAX_REQ];
+    INSTANCE_LIST list;
+    int ok = 0;
 
-    FILE *file = fopen(lock_file_path, "r");
-    if (!file)
+    if (!is_valid_led(target_led))
     {
-        printf("Traffic monitor for %s is not running.\n", iface);
+        fprintf(stderr, "Invalid LED name '%s'. Only 'lan' or 'power' allowed.\n", target_led);
         return EXIT_FAILURE;
     }
 
-    int pid;
-    if (fscanf(file, "%d", &pid) != 1)
+    query_instances("list", &list);
+    for (int i = 0; i < list.count; i++)
     {
-        fclose(file);
-        printf("Failed to read PID from lock file for %s.\n", iface);
-        return EXIT_FAILURE;
+        if (strcmp(list.v[i].led, target_led) == 0 && strcmp(list.v[i].ifname, iface) != 0)
+        {
+            fprintf(stderr, "LED '%s' is already in use by %s.\n", target_led, list.v[i].ifname);
+            free(list.v);
+            return EXIT_FAILURE;
+        }
     }
-    fclose(file);
+    free(list.v);
 
-    file = fopen(iface_file_path, "r");
-    if (!file)
+    snprintf(req, sizeof(req), "led %s %s", iface, target_led);
+    ctl_foreach(req, on_led_set, &ok);
+
+    if (!ok)
     {
-        printf("Traffic monitor is running (PID: %d), but LED/interface is unknown.\n", pid);
-        return EXIT_SUCCESS;
+        printf("Traffic monitor for %s is not running.\n", iface);
+        return EXIT_FAILURE;
     }
 
-    char real_iface[32] = {0};
-    char led_used[16] = {0};
+    printf("Interface %s now drives LED %s.\n", iface, target_led);
+    return EXIT_SUCCESS;
+}
+
+int read_attr(NET_ATTRS *na, net_attr_t attr, uint64_t *val)
+{
+    if (netattr_read(na, attr, val) < 0)
+        return -1;
+    counters.sysfs_reads++;
+    return 0;
+}
+
+// Packet and drop counters; rtnetlink has them all in one attribute, sysfs takes a read each
+void read_drop_counters(NET_ATTRS *na, LINK_STATS *st)
+{
+    read_attr(na, NET_RX_PACKETS, &st->rx_packets);
+    read_attr(na, NET_TX_PACKETS, &st->tx_packets);
+    read_attr(na, NET_RX_DROPPED, &st->rx_dropped);
+    read_attr(na, NET_TX_DROPPED, &st->tx_dropped);
+    read_attr(na, NET_RX_ERRORS, &st->rx_errors);
+    read_attr(na, NET_TX_ERRORS, &st->tx_errors);
+    read_attr(na, NET_RX_MISSED, &st->rx_missed_errors);
+    read_attr(na, NET_RX_FIFO, &st->rx_fifo_errors);
+    read_attr(na, NET_RX_OVER, &st->rx_over_errors);
+}
 
-    int n = fscanf(file, "%31s %15s", real_iface, led_used);
-    fclose(file);
+// Every interface a link dump met, with its attributes kept open across passes
+static NET_ATTRS *dump_attrs;
+static int dump_attr_count;
 
-    if (n == 2)
+NET_ATTRS *dump_attrs_get(const char *ifname)
+{
+    for (int i = 0; i < dump_attr_count; i++)
     {
-        if (kill(pid, 0) == 0)
+        if (strcmp(dump_attrs[i].ifname, ifname) == 0)
         {
-            printf("Traffic monitor is running (PID: %d), interface: %s, LED: %s\n", pid, real_iface, led_used);
-            return EXIT_SUCCESS;
+            dump_attrs[i].seen = 1;
+            return &dump_attrs[i];
         }
     }
-    else if (n == 1)
+
+    NET_ATTRS *tmp = realloc(dump_attrs, (dump_attr_count + 1) * sizeof(*tmp));
+    if (!tmp)
+        return NULL;
+    dump_attrs = tmp;
+
+    NET_ATTRS *na = &dump_attrs[dump_attr_count++];
+    netattr_init(na, ifname);
+    na->seen = 1;
+    return na;
+}
+
+// Close what the last pass didn't see; everything, when all is set
+void dump_attrs_sweep(int all)
+{
+    for (int i = 0; i < dump_attr_count;)
     {
-        if (kill(pid, 0) == 0)
+        if (dump_attrs[i].seen && !all)
         {
-            printf("Traffic monitor is running (PID: %d), interface: %s, LED: unknown\n", pid, real_iface);
-            return EXIT_SUCCESS;
+            dump_attrs[i].seen = 0;
+            i++;
+            continue;
         }
+        netattr_close(&dump_attrs[i]);
+        dump_attrs[i] = dump_attrs[--dump_attr_count];
     }
-
-    printf("Lock file exists for %s but process not found. Cleaning up.\n", iface);
-    remove_lock_file();
-    return EXIT_FAILURE;
 }
 
-long get_traffic(const char *iface, const char *direction)
+// The sysfs counterpart of rtnl_dump_links, for trees without rtnetlink
+int sysfs_dump_links(rtnl_link_cb cb, void *arg)
 {
-    char path[128];
-    snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s_bytes", iface, direction);
-
-    FILE *file = fopen(path, "r");
-    if (!file)
-        return 0;
+    char path[256];
+    struct dirent *entry;
 
-    long bytes;
-    fscanf(file, "%ld", &bytes);
-    fclose(file);
-    return bytes;
-}
+    hgl_path(path, sizeof(path), "/sys/class/net");
+    DIR *dir = opendir(path);
+    if (!dir)
+        return -1;
+    counters.sysfs_reads++;
 
-void blink_led(const char *led_name, Pattern pattern, int first_ms, int second_ms, int repeat)
-{
-    for (int i = 0; i < repeat; i++)
+    while ((entry = readdir(dir)) != NULL)
     {
-        switch (pattern)
+        LINK_STATS st;
+        uint64_t v = 0;
+        char link[256];
+
+        // Too long for an interface name, so not one
+        if (entry->d_name[0] == '.' || strlen(entry->d_name) >= IFNAMSIZ)
+            continue;
+
+        NET_ATTRS *na = dump_attrs_get(entry->d_name);
+        if (!na)
+            continue;
+
+        memset(&st, 0, sizeof(st));
+        memcpy(st.ifname, entry->d_name, strlen(entry->d_name) + 1);
+        if (read_attr(na, NET_IFINDEX, &v) == 0)
+            st.ifindex = (int)v;
+        st.carrier = read_attr(na, NET_CARRIER, &v) == 0 && v == 1;
+        read_attr(na, NET_RX_BYTES, &st.rx_bytes);
+        read_attr(na, NET_TX_BYTES, &st.tx_bytes);
+        if (sample_drops)
+            read_drop_counters(na, &st);
+        else
         {
-        case DIS_ON:
-            led(led_name, "dis");
-            sleep_ms(first_ms);
-            led(led_name, "on");
-            sleep_ms(second_ms);
-            break;
-        case DIS_OFF:
-            led(led_name, "dis");
-            sleep_ms(first_ms);
-            led(led_name, "off");
-            sleep_ms(second_ms);
-            break;
-        case ON_OFF:
-            led(led_name, "on");
-            sleep_ms(first_ms);
-            led(led_name, "off");
-            sleep_ms(second_ms);
-            break;
-        case OFF_ON:
-            led(led_name, "off");
-            sleep_ms(first_ms);
-            led(led_name, "on");
-            sleep_ms(second_ms);
-            break;
-        default:
-            break;
+            read_attr(na, NET_RX_PACKETS, &st.rx_packets);
+            read_attr(na, NET_TX_PACKETS, &st.tx_packets);
         }
+
+        // 'master' is a symlink to the bridge or bond. Looking it up may
+        // move the cache, so na is not used past here.
+        hgl_path(path, sizeof(path), "/sys/class/net/%s/master", st.ifname);
+        ssize_t n = readlink(path, link, sizeof(link) - 1);
+        if (n > 0)
+        {
+            link[n] = '\0';
+            const char *master = strrchr(link, '/');
+            master = master ? master + 1 : link;
+            NET_ATTRS *m = strlen(master) < IFNAMSIZ ? dump_attrs_get(master) : NULL;
+            if (m && read_attr(m, NET_IFINDEX, &v) == 0)
+                st.master = (int)v;
+        }
+
+        cb(&st, arg);
     }
+    closedir(dir);
+    dump_attrs_sweep(0);
+    return 0;
 }
 
 int clamp(int val, int min, int max)
@@ -538,137 +685,2000 @@ int clamp(int val, int min, int max)
     return val;
 }
 
-bool trx_hi(long rate)
+bool trx_hi(uint64_t rate)
 {
     return rate > TRAFFIC_THRESHOLD;
 }
 
-long current_time_ms()
+int is_source(const BINDING *b)
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000L + tv.tv_usec / 1000L;
+    return b->softnet || b->conntrack;
 }
 
-void monitor_traffic()
+// Reuses a slot left by a binding that was stopped and cleaned up, so reloads don't grow the array
+BINDING *add_binding(const char *name, const char *ifname, const char *led)
 {
-    long prev_rx = get_traffic(interface_name, "rx");
-    long prev_tx = get_traffic(interface_name, "tx");
+    BINDING *b = NULL;
 
-    long last_activity_time = current_time_ms();
+    for (int i = 0; i < binding_count && !b; i++)
+    {
+        if (bindings[i].stopped && !bindings[i].hist)
+            b = &bindings[i];
+    }
 
-    static int lb_rate = -1;
-    static int lb_pattern = -1;
+    if (!b)
+    {
+        BINDING *tmp = realloc(bindings, (binding_count + 1) * sizeof(*bindings));
+        if (!tmp)
+            return NULL;
+        bindings = tmp;
+        b = &bindings[binding_count++];
+    }
 
-    while (running)
+    memset(b, 0, sizeof(*b));
+    snprintf(b->name, sizeof(b->name), "%s", name);
+    snprintf(b->ifname, sizeof(b->ifname), "%s", ifname);
+    snprintf(b->led, sizeof(b->led), "%s", led);
+    netattr_init(&b->attrs, ifname);
+    b->led_state = LED_STATE_UNKNOWN;
+    b->lb_rate = -1;
+    b->lb_pattern = -1;
+    b->lc.brightness_fd = -1;
+    b->lc.interval_fd = -1;
+    b->lc_off.brightness_fd = -1;
+    b->lc_off.interval_fd = -1;
+    b->smoothing = DEFAULT_SMOOTHING;
+    b->curve = CURVE_LOG;
+    b->capacity = (uint64_t)DEFAULT_CEILING * 1000000 / 8;
+    return b;
+}
+
+BINDING *find_binding_by_led(const char *led)
+{
+    for (int i = 0; i < binding_count; i++)
     {
-        long curr_rx = get_traffic(interface_name, "rx");
-        long curr_tx = get_traffic(interface_name, "tx");
+        if (!bindings[i].stopped && strcmp(bindings[i].led, led) == 0)
+            return &bindings[i];
+    }
+    return NULL;
+}
 
-        long rx_diff = curr_rx >= prev_rx ? curr_rx - prev_rx : 0;
-        long tx_diff = curr_tx >= prev_tx ? curr_tx - prev_tx : 0;
-        long rx_rate = rx_diff / KB;
-        long tx_rate = tx_diff / KB;
-        long final_rate = rx_rate + tx_rate;
+// Apply one link notification to a binding; returns 1 if it went up or down
+int binding_link_event(BINDING *b, const LINK_STATS *st)
+{
+    int was_up = b->ifindex && b->carrier;
 
-        long safe_rate = final_rate;
-        if (safe_rate <= 0)
-        {
-            safe_rate = 1;
-        }
-        int rate = clamp(MAX_VAL - (int)(log10(safe_rate + 1) * 10), MIN_BLINK_DELAY, MAX_BLINK_DELAY);
-        long now = current_time_ms();
-        int iface_status = check_iface(interface_name);
+    // Groups follow their members from the per-tick dump
+    if (b->group || is_source(b))
+        return 0;
 
-        if (!iface_status)
-        {
-            if (last_led_state != LED_STATE_OFF)
-            {
-                blink_led(led_name, DIS_OFF, 100, 100, 1);
-                last_led_state = LED_STATE_OFF;
-            }
-        }
-        else if (trx_hi(final_rate))
+    if (b->ifindex && st->ifindex == b->ifindex)
+    {
+        if (st->removed)
         {
-            if (last_led_state != LED_STATE_BLINK || lb_pattern != DIS_ON || lb_rate != rate)
-            {
-                blink_led(led_name, DIS_ON, rate, rate, 1);
-                last_led_state = LED_STATE_BLINK;
-                lb_pattern = DIS_ON;
-                lb_rate = rate;
-            }
-            last_activity_time = now;
+            log_write(LOG_NOTICE, LOG_CLASS_LINK, "Interface %s removed.", b->cur_name);
+            b->ifindex = 0;
+            b->carrier = 0;
         }
         else
         {
-            if (now - last_activity_time > IDLE_TIMEOUT)
-            {
-                if (last_led_state != LED_STATE_ON)
-                {
-                    led(led_name, "on");
-                    last_led_state = LED_STATE_ON;
-                }
-            }
-            else
+            // Keep following the same ifindex across renames
+            if (st->ifname[0] && strcmp(st->ifname, b->cur_name) != 0)
             {
-                if (last_led_state != LED_STATE_BLINK || lb_pattern != OFF_ON)
-                {
-                    blink_led(led_name, OFF_ON, 100, 100, 1);
-                    last_led_state = LED_STATE_BLINK;
-                    lb_pattern = OFF_ON;
-                }
+                log_write(LOG_NOTICE, LOG_CLASS_LINK, "Interface %s renamed to %s.", b->cur_name, st->ifname);
+                snprintf(b->cur_name, sizeof(b->cur_name), "%s", st->ifname);
+                if (b->offload)
+                    ledcls_netdev(&b->lc, b->cur_name, b->lc.interval > 0 ? b->lc.interval : MAX_BLINK_DELAY);
             }
+            b->carrier = st->carrier;
         }
+    }
+    else if (!b->ifindex && !st->removed && strcmp(st->ifname, b->ifname) == 0)
+    {
+        b->ifindex = st->ifindex;
+        b->carrier = st->carrier;
+        b->primed = 0;
+        snprintf(b->cur_name, sizeof(b->cur_name), "%s", st->ifname);
+    }
 
-        prev_rx = curr_rx;
-        prev_tx = curr_tx;
-
-#ifdef DEBUG
-        snprintf(log_buf, sizeof(log_buf),
-                 "Traffic: RX: %ld KB/s, TX: %ld KB/s, Total: %ld KB/s, Blink delay: %d ms",
-                 rx_rate, tx_rate, final_rate, rate);
-        log_msg(log_buf);
-#endif // DEBUG
-
-        if (!running)
-            break;
-
-        sleep_ms(MAX_VAL);
+    int is_up = b->ifindex && b->carrier;
+    if (is_up != was_up)
+    {
+        log_write(LOG_NOTICE, LOG_CLASS_LINK, "Interface %s is %s.", b->ifname, is_up ? "up" : "down");
     }
+    return is_up != was_up;
 }
 
-void daemonize()
+int resync_binding(BINDING *b)
 {
-    if (fork() > 0)
-        exit(EXIT_SUCCESS);
-    if (setsid() < 0)
-        exit(EXIT_FAILURE);
+    LINK_STATS st;
+    int was_up = b->ifindex && b->carrier;
 
-    setup_signals();
+    if (b->group || is_source(b))
+        return 0;
+    if (b->ifindex && rtnl_get_link(NULL, b->ifindex, &st) == 0)
+        return binding_link_event(b, &st);
 
-    if (fork() > 0)
-        exit(EXIT_SUCCESS);
+    b->ifindex = 0;
+    b->carrier = 0;
+    if (rtnl_get_link(b->ifname, 0, &st) == 0)
+        binding_link_event(b, &st);
 
-    umask(0);
-    chdir("/");
+    return (b->ifindex && b->carrier) != was_up;
+}
 
-    redirect_stdio_to_null();
-    create_lock_file();
+int sample_binding(BINDING *b)
+{
+    LINK_STATS *st = &b->st;
+
+    if (mon_fd >= 0)
+    {
+        // Presence and carrier are pushed by link notifications
+        counters.rtnl_requests += b->ifindex != 0;
+        if (b->ifindex && rtnl_get_link(NULL, b->ifindex, st) == 0)
+            return b->carrier;
+
+        memset(st, 0, sizeof(*st));
+        return 0;
+    }
 
-    log_msg("Daemon started.");
+    if (use_rtnl)
+    {
+        counters.rtnl_requests++;
+        if (rtnl_get_link(b->ifname, 0, st) == 0)
+            return st->carrier;
+        if (errno == ENODEV)
+        {
+            memset(st, 0, sizeof(*st));
+            return 0;
+        }
+    }
 
-    wait_for_interface(interface_name);
+    uint64_t carrier = 0;
 
-    snprintf(log_buf, sizeof(log_buf),
-             "Starting traffic monitor for interface %s...", interface_name);
-    log_msg(log_buf);
+    memset(st, 0, sizeof(*st));
+    read_attr(&b->attrs, NET_RX_BYTES, &st->rx_bytes);
+    read_attr(&b->attrs, NET_TX_BYTES, &st->tx_bytes);
+    if (b->overload)
+        read_drop_counters(&b->attrs, st);
+    st->carrier = read_attr(&b->attrs, NET_CARRIER, &carrier) == 0 && carrier == 1;
+    return st->carrier;
 }
 
-void show_help(const char *prog)
+void on_dump_link(const LINK_STATS *st, void *arg)
 {
-    printf("\n");
-    printf("████████ ██████   █████  ███████ ███    ███  ██████  ███    ██ \n");
-    printf("   ██    ██   ██ ██   ██ ██      ████  ████ ██    ██ ████   ██ \n");
+    (void)arg;
+
+    for (int i = 0; i < binding_count; i++)
+    {
+        BINDING *b = &bindings[i];
+
+        if (b->stopped)
+            continue;
+        if (b->group)
+            group_feed(b->group, st);
+        else if (b->ifindex && b->ifindex == st->ifindex)
+        {
+            b->st = *st;
+            b->sampled = 1;
+        }
+    }
+}
+
+// Negotiated speed in Mbit/s, 0 when the link reports none; "-1" parses as 0
+int link_speed(const char *ifname)
+{
+    NET_ATTRS *na = dump_attrs_get(ifname);
+    uint64_t mbit = 0;
+
+    if (!na || read_attr(na, NET_SPEED, &mbit) < 0)
+        return 0;
+    return mbit > INT_MAX ? 0 : (int)mbit;
+}
+
+// Capacity in bytes/s: configured ceiling, else the negotiated link speed.
+// A group's is the sum of its members' speeds, since they carry traffic side
+// by side; a member reporting none counts as DEFAULT_CEILING.
+void update_capacity(BINDING *b)
+{
+    int mbit = b->ceiling;
+
+    // Conntrack takes the table size on every sample
+    if (b->conntrack)
+        return;
+
+    // Softnet load is packets/s on the busiest core, the ceiling in kpps
+    if (b->softnet)
+    {
+        b->capacity = (uint64_t)(b->ceiling > 0 ? b->ceiling : SOFTNET_DEFAULT_KPPS) * 1000;
+        return;
+    }
+
+    if (mbit <= 0 && b->group)
+    {
+        mbit = 0;
+        b->capacity_members = b->group->member_count;
+        for (int i = 0; i < b->group->member_count; i++)
+        {
+            int speed = link_speed(b->group->members[i].ifname);
+            mbit += speed ? speed : DEFAULT_CEILING;
+        }
+    }
+    else if (mbit <= 0)
+    {
+        mbit = link_speed(b->cur_name[0] ? b->cur_name : b->ifname);
+    }
+
+    if (mbit <= 0)
+        mbit = DEFAULT_CEILING;
+    b->capacity = (uint64_t)mbit * 1000000 / 8;
+}
+
+// One counter read per tick: a single link dump covers every binding, and
+// is the only way to see the members of a group
+void sample_bindings()
+{
+    int dump = mon_fd >= 0 && binding_count > 1;
+
+    sample_drops = 0;
+    for (int i = 0; i < binding_count; i++)
+    {
+        BINDING *b = &bindings[i];
+
+        if (b->stopped)
+            continue;
+        if (b->softnet)
+            b->up = softnet_read(b->softnet) == 0;
+        dump |= b->group != NULL;
+        sample_drops |= b->overload;
+    }
+
+    if (dump)
+    {
+        int ret;
+
+        for (int i = 0; i < binding_count; i++)
+        {
+            bindings[i].sampled = 0;
+            if (bindings[i].group)
+                group_begin(bindings[i].group);
+        }
+
+        if (use_rtnl)
+        {
+            counters.rtnl_requests++;
+            ret = rtnl_dump_links(on_dump_link, NULL);
+        }
+        else
+        {
+            ret = sysfs_dump_links(on_dump_link, NULL);
+        }
+
+        if (ret == 0)
+        {
+            for (int i = 0; i < binding_count; i++)
+            {
+                BINDING *b = &bindings[i];
+
+                if (b->stopped || is_source(b))
+                    continue;
+                if (b->group)
+                {
+                    b->up = group_end(b->group, &b->st);
+                    // Joins and leaves change what the group can carry
+                    if (b->primed && b->ceiling <= 0 && b->group->member_count != b->capacity_members)
+                        update_capacity(b);
+                }
+                else if (mon_fd < 0)
+                    b->up = sample_binding(b); // no ifindex without link notifications
+                else
+                {
+                    if (!b->sampled)
+                        memset(&b->st, 0, sizeof(b->st));
+                    b->up = b->sampled && b->carrier;
+                }
+            }
+            return;
+        }
+    }
+
+    // A failed dump leaves groups on their last sample, which reads as no traffic
+    for (int i = 0; i < binding_count; i++)
+    {
+        if (!bindings[i].stopped && !bindings[i].group && !is_source(&bindings[i]))
+            bindings[i].up = sample_binding(&bindings[i]);
+    }
+}
+
+// Start a pattern on the binding's LED. Only the first frame is written
+// here; the rest are deadlines run from the event loop, so a new pattern
+// simply replaces the one in flight.
+void blink_led(BINDING *b, Pattern pattern, int first_ms, int second_ms, int repeat)
+{
+    ANIMATION *a = &b->anim;
+
+    if (repeat <= 0)
+    {
+        a->deadline = 0;
+        return;
+    }
+
+    a->pattern = pattern;
+    a->frame = 0;
+    a->first_ms = first_ms;
+    a->second_ms = second_ms;
+    a->repeat = repeat;
+    a->deadline = monotonic_ms() + first_ms;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    led(b->led, pattern_states[pattern][0]);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    counters.blink_calls++;
+    counters.blink_ns += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+}
+
+void stop_animation(BINDING *b)
+{
+    b->anim.deadline = 0;
+}
+
+void step_animation(BINDING *b)
+{
+    ANIMATION *a = &b->anim;
+
+    if (a->frame == 0)
+    {
+        led(b->led, pattern_states[a->pattern][1]);
+        a->frame = 1;
+        // The last frame is held until the next pattern, no need to wake for it
+        a->deadline = --a->repeat > 0 ? a->deadline + a->second_ms : 0;
+    }
+    else
+    {
+        led(b->led, pattern_states[a->pattern][0]);
+        a->frame = 0;
+        a->deadline += a->first_ms;
+    }
+}
+
+// Advance every due animation; returns the epoll timeout until the next frame
+int run_animations()
+{
+    long now = monotonic_ms();
+    long next = -1;
+
+    for (int i = 0; i < binding_count; i++)
+    {
+        ANIMATION *a = &bindings[i].anim;
+
+        while (a->deadline && a->deadline <= now)
+            step_animation(&bindings[i]);
+
+        if (a->deadline && (next < 0 || a->deadline < next))
+            next = a->deadline;
+    }
+
+    return next < 0 ? -1 : (int)(next - now);
+}
+
+void set_led_state(BINDING *b, led_state_t state)
+{
+    if (b->led_state != state)
+        counters.led_transitions++;
+    b->led_state = state;
+}
+
+void update_led(BINDING *b, int iface_status, uint64_t final_rate, int rate, long now)
+{
+    // Offloaded LEDs follow link and activity in the kernel
+    if (b->offload)
+        return;
+
+    // A saturated box shows 'warn' over any traffic pattern until it calms down
+    if (iface_status && now < b->overload_until)
+    {
+        if (b->pwm)
+            pwm_set_duty(b->pwm, PWM_HOLD_WARN);
+        else if (b->led_state != LED_STATE_WARN)
+        {
+            stop_animation(b);
+            led(b->led, "warn");
+        }
+        set_led_state(b, LED_STATE_WARN);
+        return;
+    }
+
+    // Brightness follows the blink curve: the shortest delay is full duty
+    if (b->pwm)
+    {
+        int duty = PWM_HOLD_OFF;
+
+        if (iface_status)
+            duty = PWM_MIN_DUTY + (PWM_STEPS - PWM_MIN_DUTY) * (MAX_BLINK_DELAY - rate) /
+                                      (MAX_BLINK_DELAY - MIN_BLINK_DELAY);
+        pwm_set_duty(b->pwm, duty);
+        set_led_state(b, iface_status ? LED_STATE_PWM : LED_STATE_OFF);
+        return;
+    }
+
+    if (!iface_status)
+    {
+        if (b->led_state != LED_STATE_OFF)
+        {
+            blink_led(b, DIS_OFF, 100, 100, 1);
+            set_led_state(b, LED_STATE_OFF);
+        }
+    }
+    else if (trx_hi(final_rate))
+    {
+        // Blink while traffic lasts, green/red when it sits on one queue; a steadier rate only changes the timing
+        Pattern pattern = b->imbalanced ? ON_OFF : DIS_ON;
+
+        if (b->led_state != LED_STATE_BLINK || b->lb_pattern != (int)pattern || !b->anim.deadline)
+        {
+            blink_led(b, pattern, rate, rate, 1);
+            set_led_state(b, LED_STATE_BLINK);
+            b->lb_pattern = pattern;
+            b->lb_rate = rate;
+        }
+        b->last_activity_time = now;
+    }
+    else
+    {
+        if (now - b->last_activity_time > IDLE_TIMEOUT)
+        {
+            if (b->led_state != LED_STATE_ON)
+            {
+                stop_animation(b);
+                led(b->led, "on");
+                set_led_state(b, LED_STATE_ON);
+            }
+        }
+        else
+        {
+            if (b->led_state != LED_STATE_BLINK || b->lb_pattern != OFF_ON)
+            {
+                blink_led(b, OFF_ON, 100, 100, 1);
+                set_led_state(b, LED_STATE_BLINK);
+                b->lb_pattern = OFF_ON;
+            }
+        }
+    }
+}
+
+// Time-aware EWMA: alpha = dt / (tau + dt), so the smoothing doesn't depend on the tick period
+uint64_t ewma(uint64_t avg, uint64_t sample, long elapsed, int tau)
+{
+    if (tau <= 0 || elapsed <= 0)
+        return sample;
+    if (sample >= avg)
+        return avg + (sample - avg) * elapsed / (tau + elapsed);
+    // Round the decay up, or small rates would never get back to zero
+    return avg - ((avg - sample) * elapsed + tau + elapsed - 1) / (tau + elapsed);
+}
+
+// Precompute load -> blink delay for every curve, so the hot path is a table lookup
+void build_curves()
+{
+    static const int steps[][2] = {{10, MAX_BLINK_DELAY}, {100, 117}, {500, 83}, {LOAD_STEPS + 1, MIN_BLINK_DELAY}};
+    const int span = MAX_BLINK_DELAY - MIN_BLINK_DELAY;
+
+    for (int load = 0; load <= LOAD_STEPS; load++)
+    {
+        // log: 0.1% of capacity is the bottom of the curve, 100% the top
+        double l = log10(1.0 + (LOAD_STEPS - 1) * (double)load / LOAD_STEPS) / log10(LOAD_STEPS);
+        curve_tables[CURVE_LOG][load] = MAX_BLINK_DELAY - (int)(span * l + 0.5);
+        curve_tables[CURVE_LINEAR][load] = MAX_BLINK_DELAY - span * load / LOAD_STEPS;
+
+        int i = 0;
+        while (load >= steps[i][0])
+            i++;
+        curve_tables[CURVE_STEPPED][load] = steps[i][1];
+    }
+}
+
+curve_t parse_curve(const char *name)
+{
+    for (int i = 0; i < CURVE_COUNT; i++)
+    {
+        if (strcmp(name, curve_names[i]) == 0)
+            return i;
+    }
+    return CURVE_LOG;
+}
+
+int blink_delay(BINDING *b)
+{
+    uint64_t load = b->rate_bps * LOAD_STEPS / b->capacity;
+
+    b->load = load > LOAD_STEPS ? LOAD_STEPS : (int)load;
+    return curve_tables[b->curve][b->load];
+}
+
+// History is kept per section, so a group never records into the file of
+// a plain binding on its first member. Sources record none.
+HISTORY *binding_history(BINDING *b)
+{
+    if (is_source(b))
+        return NULL;
+    return history_create(b->name, b->ifname);
+}
+
+// Drop the files of sections gone from the config, or left by an older run
+void prune_history(void)
+{
+    const char **names = malloc((binding_count + 1) * sizeof(*names));
+    int n = 0;
+
+    if (!names)
+        return;
+
+    for (int i = 0; i < binding_count; i++)
+    {
+        if (!bindings[i].stopped && bindings[i].hist)
+            names[n++] = bindings[i].name;
+    }
+    history_prune(names, n);
+    free(names);
+}
+
+void publish_binding(BINDING *b, long now)
+{
+    if (!stats_shm)
+        return;
+
+    STATS_SAMPLE s = {
+        .timestamp = now,
+        .rx_bps = b->up ? b->rx_bps : 0,
+        .tx_bps = b->up ? b->tx_bps : 0,
+        .rx_packets = b->st.rx_packets,
+        .tx_packets = b->st.tx_packets,
+        .carrier = b->up,
+        .led_state = b->led_state,
+        .pps = b->pps,
+        .drop_rate = b->drop_rate,
+        .error_rate = b->error_rate,
+        .rxq_count = b->rxq.queues,
+        .rxq_imbalance = b->rxq.imbalance,
+        .rxq_busiest = b->rxq.busiest,
+        .txq_count = b->txq.queues,
+        .txq_imbalance = b->txq.imbalance,
+        .txq_busiest = b->txq.busiest,
+        .offload = b->offload,
+        .busy_cpu = b->busy_cpu,
+        .source = b->softnet ? STATS_SOURCE_SOFTNET : b->conntrack ? STATS_SOURCE_CONNTRACK : STATS_SOURCE_LINK,
+        .ct_count = b->ct_count,
+        .ct_max = b->ct_max,
+        .ct_failed = b->ct_failed,
+    };
+    stats_push(&stats_shm->slots[b - bindings], &s);
+}
+
+// Hand the LED pins to a PWM thread; blinking takes over again on detach
+int brightness_attach(BINDING *b)
+{
+    GPIO_PINS *pins = led_pins();
+    const int *p = strcmp(b->led, "power") == 0 ? pins->power : pins->lan;
+
+    stop_animation(b);
+    b->pwm = calloc(1, sizeof(*b->pwm));
+    if (!b->pwm || pwm_start(b->pwm, p[0], p[1]) < 0)
+    {
+        free(b->pwm);
+        b->pwm = NULL;
+        return -1;
+    }
+    b->led_state = LED_STATE_UNKNOWN;
+    return 0;
+}
+
+void brightness_detach(BINDING *b)
+{
+    pwm_stop(b->pwm);
+    free(b->pwm);
+    b->pwm = NULL;
+    b->led_state = LED_STATE_UNKNOWN;
+    b->lb_rate = -1;
+    b->lb_pattern = -1;
+}
+
+uint64_t per_second(uint64_t curr, uint64_t *prev, long elapsed)
+{
+    uint64_t n = curr >= *prev ? curr - *prev : 0;
+
+    *prev = curr;
+    return elapsed > 0 ? n * 1000 / elapsed : 0;
+}
+
+// Packet-rate overload shows up as drops long before bytes/s looks high. The
+// rates share the byte rate's smoothing, so one lost packet in a short tick
+// doesn't read as a flood.
+void check_overload(BINDING *b, long elapsed, long now)
+{
+    uint64_t pps = per_second(b->st.rx_packets + b->st.tx_packets, &b->prev_packets, elapsed);
+    uint64_t drops = per_second(link_drops(&b->st), &b->prev_drops, elapsed);
+    uint64_t errors = per_second(b->st.rx_errors + b->st.tx_errors, &b->prev_errors, elapsed);
+
+    b->pps = ewma(b->pps, pps, elapsed, b->smoothing);
+    b->drop_rate = ewma(b->drop_rate, drops, elapsed, b->smoothing);
+    b->error_rate = ewma(b->error_rate, errors, elapsed, b->smoothing);
+
+    if (!b->overload)
+    {
+        b->overload_until = 0;
+        return;
+    }
+
+    if (b->drop_rate >= (uint64_t)b->overload)
+    {
+        if (!b->overload_until)
+            log_write(LOG_WARNING, LOG_CLASS_TRAFFIC, "Interface %s overloaded: %llu drops/s at %llu pps.", b->ifname,
+                      (unsigned long long)b->drop_rate, (unsigned long long)b->pps);
+        b->overload_until = now + OVERLOAD_HOLD;
+    }
+    else if (b->overload_until && now >= b->overload_until)
+    {
+        log_write(LOG_NOTICE, LOG_CLASS_TRAFFIC, "Interface %s no longer overloaded.", b->ifname);
+        b->overload_until = 0;
+    }
+}
+
+// Traffic that lands on one queue pins one core while the totals look fine
+void check_queues(BINDING *b, long elapsed)
+{
+    QUEUE_BALANCE rx, tx;
+    int was = b->imbalanced;
+
+    if (!b->queues || queues_sample(b->queues, b->cur_name[0] ? b->cur_name : b->ifname, elapsed, &rx, &tx) < 0)
+        return;
+
+    rx.imbalance = (int)ewma(b->rxq.imbalance, rx.imbalance, elapsed, b->smoothing);
+    tx.imbalance = (int)ewma(b->txq.imbalance, tx.imbalance, elapsed, b->smoothing);
+    b->rxq = rx;
+    b->txq = tx;
+    b->imbalanced = b->imbalance && (rx.imbalance >= b->imbalance * 10 || tx.imbalance >= b->imbalance * 10);
+
+    if (b->imbalanced && !was)
+        log_write(LOG_NOTICE, LOG_CLASS_TRAFFIC, "Interface %s queues unbalanced: rx %d.%d%% (rx-%d busiest), tx %d.%d%% (tx-%d busiest).",
+                  b->ifname, rx.imbalance / 10, rx.imbalance % 10, rx.busiest, tx.imbalance / 10, tx.imbalance % 10,
+                  tx.busiest);
+}
+
+// Softnet bindings pick a pattern instead of a blink speed: red flashes
+// while a core drops, green/red while NET_RX gets squeezed, green blinking
+// by load while busy, and steady on when idle
+void show_pressure(BINDING *b, int pattern, int delay, long now)
+{
+    if (pattern < 0)
+    {
+        if (b->led_state != LED_STATE_ON)
+        {
+            stop_animation(b);
+            led(b->led, "on");
+            set_led_state(b, LED_STATE_ON);
+        }
+        b->lb_pattern = -1;
+        return;
+    }
+
+    if (b->led_state != LED_STATE_BLINK || b->lb_pattern != pattern || !b->anim.deadline)
+    {
+        blink_led(b, pattern, delay, delay, 1);
+        set_led_state(b, LED_STATE_BLINK);
+        b->lb_pattern = pattern;
+        b->lb_rate = delay;
+    }
+    b->last_delta_time = now;
+}
+
+void process_softnet(BINDING *b, long now)
+{
+    SOFTNET_RATE r;
+    long elapsed = now - b->last_sample_time;
+
+    // The first read after (re)opening has nothing to compare against
+    if (!b->primed)
+    {
+        b->last_sample_time = now;
+        b->last_delta_time = now;
+        b->pps = 0;
+        b->drop_rate = 0;
+        b->error_rate = 0;
+        b->rate_bps = 0;
+        b->primed = 1;
+        update_capacity(b);
+        publish_binding(b, now);
+        return;
+    }
+
+    if (softnet_worst(b->softnet, elapsed, &r) < 0)
+        return;
+
+    b->busy_cpu = r.cpu;
+    b->pps = ewma(b->pps, r.processed, elapsed, b->smoothing);
+    b->drop_rate = ewma(b->drop_rate, r.dropped, elapsed, b->smoothing);
+    b->error_rate = ewma(b->error_rate, r.squeezed, elapsed, b->smoothing);
+    b->rate_bps = b->pps;
+    b->last_sample_time = now;
+
+    int rate = blink_delay(b);
+
+    if (b->drop_rate)
+        show_pressure(b, DIS_OFF, MIN_BLINK_DELAY, now);
+    else if (b->error_rate)
+        show_pressure(b, ON_OFF, rate, now);
+    else if (b->pps >= SOFTNET_IDLE_PPS)
+        show_pressure(b, DIS_ON, rate, now);
+    else
+        show_pressure(b, -1, 0, now);
+
+    publish_binding(b, now);
+
+    log_write(LOG_DEBUG, LOG_CLASS_TRAFFIC, "Softnet: busiest cpu%d, processed %llu/s, dropped %llu/s, squeezed %llu/s, Load: %d.%d%%",
+              b->busy_cpu, (unsigned long long)b->pps, (unsigned long long)b->drop_rate,
+              (unsigned long long)b->error_rate, b->load / 10, b->load % 10);
+}
+
+// The table is read at a low cadence; in between the LED keeps its pattern going
+void process_conntrack(BINDING *b, long now)
+{
+    CONNTRACK_STATS st;
+
+    if (b->primed && now - b->last_sample_time < CONNTRACK_PERIOD)
+    {
+        show_pressure(b, b->lb_pattern, b->lb_rate, now);
+        return;
+    }
+
+    b->up = conntrack_read(b->conntrack, &st) == 0;
+    if (!b->up)
+    {
+        update_led(b, 0, 0, MAX_BLINK_DELAY, now);
+        b->primed = 0;
+        publish_binding(b, now);
+        return;
+    }
+
+    uint64_t failures = conntrack_failures(&st);
+    long elapsed = now - b->last_sample_time;
+
+    if (!b->primed)
+    {
+        b->prev_drops = failures;
+        b->primed = 1;
+        elapsed = 0;
+    }
+
+    uint64_t failed = failures >= b->prev_drops ? failures - b->prev_drops : 0;
+
+    b->prev_drops = failures;
+    b->last_sample_time = now;
+    b->ct_count = st.count;
+    b->ct_failed = elapsed > 0 ? (failed * 1000 + elapsed - 1) / elapsed : 0;
+    b->rate_bps = st.count;
+    b->capacity = b->ceiling > 0 ? (uint64_t)b->ceiling : st.max ? st.max : 1;
+    b->ct_max = b->capacity;
+
+    int rate = blink_delay(b);
+
+    if (failed)
+    {
+        log_write(LOG_WARNING, LOG_CLASS_TRAFFIC, "Conntrack table at %llu of %llu, %llu connections not tracked.",
+                  (unsigned long long)st.count, (unsigned long long)st.max, (unsigned long long)failed);
+        show_pressure(b, DIS_OFF, MIN_BLINK_DELAY, now);
+    }
+    else if (b->load >= CONNTRACK_FULL_LOAD)
+        show_pressure(b, ON_OFF, rate, now);
+    else if (b->load >= CONNTRACK_BUSY_LOAD)
+        show_pressure(b, DIS_ON, rate, now);
+    else
+        show_pressure(b, -1, 0, now);
+
+    publish_binding(b, now);
+
+    log_write(LOG_DEBUG, LOG_CLASS_TRAFFIC, "Conntrack: %llu of %llu entries, %llu failed, Load: %d.%d%%",
+              (unsigned long long)st.count, (unsigned long long)st.max, (unsigned long long)failed,
+              b->load / 10, b->load % 10);
+}
+
+void process_binding(BINDING *b, long now)
+{
+    if (b->pwm && pwm_failed(b->pwm))
+    {
+        PWM_STATS ps;
+
+        pwm_get_stats(b->pwm, &ps);
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "LED %s: PWM too costly (write %ld us, jitter %ld us), blinking instead.",
+                  b->led, ps.write_avg_ns / 1000, ps.jitter_avg_ns / 1000);
+        brightness_detach(b);
+    }
+
+    if (b->softnet && b->up)
+    {
+        process_softnet(b, now);
+        return;
+    }
+    if (b->conntrack)
+    {
+        process_conntrack(b, now);
+        return;
+    }
+
+    if (!b->up)
+    {
+        update_led(b, 0, 0, MAX_BLINK_DELAY, now);
+        b->primed = 0;
+        if (b->hist)
+            history_add(b->hist, now, 0, 0);
+        publish_binding(b, now);
+        return;
+    }
+
+    uint64_t curr_rx = b->st.rx_bytes;
+    uint64_t curr_tx = b->st.tx_bytes;
+
+    // Take a fresh baseline whenever the link (re)appears
+    if (!b->primed)
+    {
+        b->prev_rx = curr_rx;
+        b->prev_tx = curr_tx;
+        b->last_activity_time = now;
+        b->last_sample_time = now;
+        b->last_delta_time = now;
+        b->rate_bps = 0;
+        b->prev_packets = b->st.rx_packets + b->st.tx_packets;
+        b->prev_drops = link_drops(&b->st);
+        b->prev_errors = b->st.rx_errors + b->st.tx_errors;
+        b->pps = 0;
+        b->drop_rate = 0;
+        b->error_rate = 0;
+        b->overload_until = 0;
+        b->primed = 1;
+        update_capacity(b);
+    }
+
+    long elapsed = now - b->last_sample_time;
+
+    // Offloaded bindings only retune the trigger interval every few seconds
+    if (b->offload && elapsed < OFFLOAD_PERIOD - MAX_VAL / 2)
+        return;
+
+    // A catch-up tick with no time passed leaves the counters for the next
+    // real interval; consuming them here would drop them from every rate
+    if (elapsed <= 0)
+    {
+        publish_binding(b, now);
+        return;
+    }
+
+    uint64_t rx_bytes = curr_rx >= b->prev_rx ? curr_rx - b->prev_rx : 0;
+    uint64_t tx_bytes = curr_tx >= b->prev_tx ? curr_tx - b->prev_tx : 0;
+
+    if (rx_bytes || tx_bytes)
+        b->last_delta_time = now;
+    if (b->hist)
+        history_add(b->hist, now, rx_bytes, tx_bytes);
+
+    // True bytes/s over the measured interval, whatever the tick period was
+    b->rx_bps = rx_bytes * 1000 / elapsed;
+    b->tx_bps = tx_bytes * 1000 / elapsed;
+    b->rate_bps = ewma(b->rate_bps, b->rx_bps + b->tx_bps, elapsed, b->smoothing);
+    check_overload(b, elapsed, now);
+    check_queues(b, elapsed);
+
+    int rate = blink_delay(b);
+
+    if (b->offload)
+        ledcls_set_interval(&b->lc, rate);
+    else
+        update_led(b, 1, b->rate_bps, rate, now);
+
+    b->last_sample_time = now;
+    b->prev_rx = curr_rx;
+    b->prev_tx = curr_tx;
+
+    publish_binding(b, now);
+
+    log_write(LOG_DEBUG, LOG_CLASS_TRAFFIC, "Traffic %s: RX: %llu KB/s, TX: %llu KB/s, Smoothed: %llu KB/s, Load: %d.%d%%, Blink delay: %d ms",
+              b->ifname, (unsigned long long)(b->rx_bps / KB), (unsigned long long)(b->tx_bps / KB),
+              (unsigned long long)(b->rate_bps / KB), b->load / 10, b->load % 10, rate);
+}
+
+void tick()
+{
+    sample_bindings();
+
+    long now = monotonic_ms();
+    for (int i = 0; i < binding_count && running; i++)
+    {
+        if (!bindings[i].stopped)
+            process_binding(&bindings[i], now);
+    }
+}
+
+void on_link_event(const LINK_STATS *st, void *arg)
+{
+    long now = *(long *)arg;
+
+    for (int i = 0; i < binding_count; i++)
+    {
+        BINDING *b = &bindings[i];
+
+        // React to carrier and presence changes without waiting for the tick
+        if (!b->stopped && binding_link_event(b, st))
+            update_led(b, b->ifindex && b->carrier, 0, MAX_BLINK_DELAY, now);
+    }
+}
+
+void handle_link_events()
+{
+    long now = monotonic_ms();
+
+    if (rtnl_monitor_read(on_link_event, &now) < 0 && errno == ENOBUFS)
+    {
+        for (int i = 0; i < binding_count; i++)
+        {
+            BINDING *b = &bindings[i];
+            if (!b->stopped && resync_binding(b))
+                update_led(b, b->ifindex && b->carrier, 0, MAX_BLINK_DELAY, now);
+        }
+    }
+}
+
+int offload_attach(BINDING *b)
+{
+    const char *ifname = b->cur_name[0] ? b->cur_name : b->ifname;
+
+    if (ledcls_open(b->sysfs_led, &b->lc) < 0 || ledcls_netdev(&b->lc, ifname, MAX_BLINK_DELAY) < 0)
+    {
+        ledcls_close(&b->lc);
+        return -1;
+    }
+
+    if (b->sysfs_led_off[0] && ledcls_open(b->sysfs_led_off, &b->lc_off) == 0)
+    {
+        ledcls_set_trigger(&b->lc_off, "none");
+        ledcls_set_brightness(&b->lc_off, 0);
+    }
+    return 0;
+}
+
+// Leave an offloaded LED in the same steady 'on' state as the GPIO path
+void offload_detach(BINDING *b)
+{
+    ledcls_set_trigger(&b->lc, "none");
+    ledcls_set_brightness(&b->lc, b->lc.max_brightness);
+    ledcls_close(&b->lc);
+
+    if (b->lc_off.brightness_fd >= 0)
+    {
+        ledcls_set_brightness(&b->lc_off, 0);
+        ledcls_close(&b->lc_off);
+    }
+}
+
+// Full rate while anything is active, back off once every LED has been steady for a while
+int tick_period(long now)
+{
+    int period = OFFLOAD_PERIOD;
+
+    for (int i = 0; i < binding_count; i++)
+    {
+        BINDING *b = &bindings[i];
+
+        if (b->offload || b->stopped)
+            continue;
+        if (b->up && (b->led_state != LED_STATE_ON || now - b->last_delta_time < IDLE_BACKOFF_AFTER))
+            return MAX_VAL;
+        period = IDLE_PERIOD;
+    }
+    return period;
+}
+
+// Arm the timer for an absolute deadline so the cadence doesn't drift with processing time
+void arm_tick(int tfd, struct timespec *next, int period)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    next->tv_sec += period / 1000;
+    next->tv_nsec += (period % 1000) * 1000000L;
+    if (next->tv_nsec >= 1000000000L)
+    {
+        next->tv_sec++;
+        next->tv_nsec -= 1000000000L;
+    }
+
+    // Fell more than a period behind (e.g. stopped); restart the grid from now
+    if (next->tv_sec < now.tv_sec - (period / 1000 + 1))
+        *next = now;
+
+    struct itimerspec its = {.it_value = *next};
+    timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// How late the timer fired against its absolute deadline
+void record_tick(const struct timespec *deadline, int period)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long late_us = (now.tv_sec - deadline->tv_sec) * 1000000L + (now.tv_nsec - deadline->tv_nsec) / 1000;
+    int i = 0;
+
+    while (i < LATENCY_BUCKETS - 1 && late_us >= latency_limits_us[i])
+        i++;
+
+    counters.ticks++;
+    counters.latency[i]++;
+    if (late_us >= period * 1000L)
+        counters.overruns++;
+}
+
+int format_counters(char *buf, size_t size)
+{
+    const GPIO_COUNTERS *gc = gpio_counters();
+    int len = snprintf(buf, size,
+                       "pid %d ticks %lu overruns %lu wakeups %lu\n"
+                       "sysfs reads %lu rtnl requests %lu\n"
+                       "gpio writes issued %lu elided %lu\n"
+                       "led transitions %lu blink_led calls %lu time %llu us\n"
+                       "tick latency",
+                       getpid(), counters.ticks, counters.overruns, counters.wakeups,
+                       counters.sysfs_reads, counters.rtnl_requests, gc->issued, gc->elided,
+                       counters.led_transitions, counters.blink_calls, counters.blink_ns / 1000);
+
+    for (int i = 0; i < LATENCY_BUCKETS && len < (int)size; i++)
+    {
+        if (i < LATENCY_BUCKETS - 1)
+            len += snprintf(buf + len, size - len, " <%dus:%lu", latency_limits_us[i], counters.latency[i]);
+        else
+            len += snprintf(buf + len, size - len, " more:%lu\n", counters.latency[i]);
+    }
+
+    for (int i = 0; i < binding_count && len < (int)size; i++)
+    {
+        PWM_STATS ps;
+
+        if (!bindings[i].pwm)
+            continue;
+        pwm_get_stats(bindings[i].pwm, &ps);
+        len += snprintf(buf + len, size - len, "pwm %s periods %lu late %lu jitter avg %ld us max %ld us write %ld us\n",
+                        bindings[i].led, ps.periods, ps.late, ps.jitter_avg_ns / 1000, ps.jitter_max_ns / 1000,
+                        ps.write_avg_ns / 1000);
+    }
+    return len;
+}
+
+void log_counters()
+{
+    char buf[1024];
+
+    format_counters(buf, sizeof(buf));
+    for (char *line = strtok(buf, "\n"); line; line = strtok(NULL, "\n"))
+        log_write(LOG_INFO, LOG_CLASS_GENERAL, "%s", line);
+}
+
+// Hand the LED back in its steady 'on' state and stop following the interface
+void release_binding(BINDING *b)
+{
+    stop_animation(b);
+    if (b->pwm)
+        brightness_detach(b);
+    if (b->offload)
+        offload_detach(b);
+    else if (b->led[0]) // parked by a reload, already handed back
+        led(b->led, "on");
+    b->stopped = 1;
+
+    log_write(LOG_INFO, LOG_CLASS_CTL, "Stopped traffic monitor for interface %s.", b->ifname);
+}
+
+int active_bindings()
+{
+    int n = 0;
+
+    for (int i = 0; i < binding_count; i++)
+        n += !bindings[i].stopped;
+    return n;
+}
+
+BINDING *find_binding_by_name(const char *name)
+{
+    for (int i = 0; i < binding_count; i++)
+    {
+        if (!bindings[i].stopped && strcmp(bindings[i].name, name) == 0)
+            return &bindings[i];
+    }
+    return NULL;
+}
+
+BINDING *find_binding_by_ifname(const char *ifname)
+{
+    for (int i = 0; i < binding_count; i++)
+    {
+        if (!bindings[i].stopped && strcmp(bindings[i].ifname, ifname) == 0)
+            return &bindings[i];
+    }
+    return NULL;
+}
+
+// Options dropped from the config fall back to their defaults on reload
+void apply_globals()
+{
+    int level = globals.log_level[0] ? log_parse_level(globals.log_level) : -1;
+
+    log_defaults();
+
+    if (level >= 0)
+        log_set_level(level);
+    if (globals.log_rate >= 0)
+        log_set_rate(globals.log_rate, globals.log_burst);
+    if (globals.log_ring >= 0)
+        log_set_ring(globals.log_ring);
+}
+
+// Several ifnames, a glob or a master make a group; a single plain ifname doesn't
+int is_group_conf(const INSTANCE_CONF *ic)
+{
+    return ic->member_count > 1 || ic->master_count || strpbrk(ic->ifname, "*?[");
+}
+
+// A source other than links: the binding follows a kernel table instead
+int is_source_conf(const INSTANCE_CONF *ic)
+{
+    return ic->source[0] && strcmp(ic->source, "link") != 0;
+}
+
+void attach_source(BINDING *b, const INSTANCE_CONF *ic)
+{
+    if (strcmp(ic->source, "softnet") == 0)
+        b->softnet = softnet_create();
+    else if (strcmp(ic->source, "conntrack") == 0)
+        b->conntrack = conntrack_create();
+}
+
+// Everything the binding reads besides rtnetlink: its source, and for a link
+// the sysfs attributes and per-queue counters. apply_instance sets up the
+// queues again, sample_binding reopens the attributes.
+void close_readers(BINDING *b)
+{
+    netattr_close(&b->attrs);
+    queues_free(b->queues);
+    b->queues = NULL;
+    softnet_free(b->softnet);
+    b->softnet = NULL;
+    conntrack_free(b->conntrack);
+    b->conntrack = NULL;
+}
+
+IF_GROUP *make_group(const INSTANCE_CONF *ic)
+{
+    if (!is_group_conf(ic))
+        return NULL;
+
+    IF_GROUP *g = group_create(ic->name);
+    if (!g)
+        return NULL;
+    for (int i = 0; i < ic->member_count; i++)
+        group_add_pattern(g, ic->members[i]);
+    for (int i = 0; i < ic->master_count; i++)
+        group_add_master(g, ic->masters[i]);
+    return g;
+}
+
+// Settings that can change under a running binding
+void apply_instance(BINDING *b, const INSTANCE_CONF *ic)
+{
+    b->offload = ic->offload;
+    b->smoothing = ic->smoothing >= 0 ? ic->smoothing : DEFAULT_SMOOTHING;
+    b->curve = parse_curve(ic->curve);
+    b->ceiling = ic->ceiling;
+    b->brightness = strcmp(ic->mode, "pwm") == 0 && !is_source_conf(ic); // patterns, not a level
+    b->overload = ic->overload > 0 ? ic->overload : 0;
+    b->imbalance = ic->imbalance > 0 ? ic->imbalance : 0;
+
+    // Per-queue counters belong to one device; groups and sources have none
+    int queues = (ic->queues || b->imbalance) && !is_group_conf(ic) && !is_source_conf(ic);
+    if (queues && !b->queues)
+        b->queues = queues_create();
+    else if (!queues)
+    {
+        queues_free(b->queues);
+        b->queues = NULL;
+        memset(&b->rxq, 0, sizeof(b->rxq));
+        memset(&b->txq, 0, sizeof(b->txq));
+        b->imbalanced = 0;
+    }
+    snprintf(b->sysfs_led, sizeof(b->sysfs_led), "%s", ic->sysfs_led);
+    snprintf(b->sysfs_led_off, sizeof(b->sysfs_led_off), "%s", ic->sysfs_led_off);
+}
+
+void publish_slot(BINDING *b)
+{
+    int i = b - bindings;
+
+    if (!stats_shm || i >= (int)stats_shm->count)
+        return;
+
+    STATS_SLOT *slot = &stats_shm->slots[i];
+    snprintf(slot->name, sizeof(slot->name), "%s", b->stopped ? "" : b->name);
+    snprintf(slot->ifname, sizeof(slot->ifname), "%s", b->stopped ? "" : b->ifname);
+    snprintf(slot->led, sizeof(slot->led), "%s", b->stopped ? "" : b->led);
+}
+
+void start_binding(BINDING *b)
+{
+    publish_slot(b);
+
+    log_write(LOG_INFO, LOG_CLASS_GENERAL, "Starting traffic monitor for interface %s with led %s...", b->ifname, b->led);
+
+    b->hist = binding_history(b);
+    if (!b->hist && !is_source(b))
+    {
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "No traffic history for %s (memory cap or %s unwritable).",
+                  b->ifname, HISTORY_DIR);
+    }
+
+    if (mon_fd >= 0 && !b->group && !is_source(b) && !resync_binding(b))
+    {
+        log_write(LOG_NOTICE, LOG_CLASS_LINK, "Interface %s not up, waiting for link events...", b->ifname);
+    }
+
+    if (b->offload && offload_attach(b) < 0)
+    {
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "LED %s: netdev trigger unavailable, driving GPIOs instead.", b->sysfs_led);
+        b->offload = 0;
+    }
+
+    if (b->brightness && !b->offload && brightness_attach(b) < 0)
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "LED %s: PWM unavailable, blinking instead.", b->led);
+}
+
+const INSTANCE_CONF *find_instance(const INSTANCE_CONF *conf, int n, const char *name)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (strcmp(conf[i].name, name) == 0)
+            return &conf[i];
+    }
+    return NULL;
+}
+
+// Same checks as at startup; a binding being updated doesn't conflict with itself
+int instance_usable(const INSTANCE_CONF *ic, const BINDING *self)
+{
+    const BINDING *other = find_binding_by_led(ic->led);
+
+    if (!ic->enabled)
+        return 0;
+    if (!ic->ifname[0] || !is_valid_led(ic->led) || (other && other != self) ||
+        (ic->offload && (!ic->sysfs_led[0] || is_group_conf(ic) || is_source_conf(ic))))
+    {
+        log_write(LOG_ERR, LOG_CLASS_GENERAL, "config '%s' is invalid or its LED is in use, skipped.", ic->name);
+        return 0;
+    }
+    return 1;
+}
+
+// Bring a surviving binding in line with its section. Only what changed is
+// touched, so an unchanged binding keeps its counter baseline, rate average and GPIOs.
+void update_binding(BINDING *b, const INSTANCE_CONF *ic)
+{
+    IF_GROUP *group = make_group(ic);
+    int regroup = !group_equal(b->group, group);
+    int relink = regroup || strcmp(b->ifname, ic->ifname) != 0 || is_source(b) != is_source_conf(ic);
+    int reled = strcmp(b->led, ic->led) != 0;
+    int reoffload = b->offload != ic->offload || strcmp(b->sysfs_led, ic->sysfs_led) != 0 ||
+                    strcmp(b->sysfs_led_off, ic->sysfs_led_off) != 0;
+    int was_offload = b->offload;
+
+    if (b->pwm && (reled || b->brightness != (strcmp(ic->mode, "pwm") == 0) || ic->offload))
+        brightness_detach(b);
+    if (was_offload && (reoffload || relink))
+    {
+        offload_detach(b);
+        was_offload = 0;
+    }
+
+    if (reled)
+    {
+        snprintf(b->led, sizeof(b->led), "%s", ic->led);
+        b->led_state = LED_STATE_UNKNOWN;
+        b->lb_rate = -1;
+        b->lb_pattern = -1;
+        log_write(LOG_NOTICE, LOG_CLASS_CTL, "Interface %s now drives LED %s.", b->ifname, b->led);
+    }
+
+    if (relink)
+    {
+        log_write(LOG_NOTICE, LOG_CLASS_LINK, "Binding %s moves from %s to %s.", b->name, b->ifname, ic->ifname);
+        snprintf(b->ifname, sizeof(b->ifname), "%s", ic->ifname);
+        snprintf(b->attrs.ifname, sizeof(b->attrs.ifname), "%s", ic->ifname);
+        group_free(b->group);
+        b->group = group;
+        group = NULL;
+        close_readers(b);
+        attach_source(b, ic);
+        b->cur_name[0] = '\0';
+        b->ifindex = 0;
+        b->carrier = 0;
+        b->up = 0;
+        b->primed = 0;
+        history_close(b->hist);
+        b->hist = binding_history(b);
+        if (mon_fd >= 0)
+            resync_binding(b);
+    }
+
+    group_free(group);
+    apply_instance(b, ic);
+    if (b->primed)
+        update_capacity(b);
+    publish_slot(b);
+
+    if (b->offload && !was_offload && offload_attach(b) < 0)
+    {
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "LED %s: netdev trigger unavailable, driving GPIOs instead.", b->sysfs_led);
+        b->offload = 0;
+    }
+    if (b->brightness && !b->pwm && !b->offload && brightness_attach(b) < 0)
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "LED %s: PWM unavailable, blinking instead.", b->led);
+}
+
+// Re-read the config and apply the difference in place; returns the active bindings or -1
+int reload_bindings()
+{
+    INSTANCE_CONF *conf;
+    int n;
+
+    if (!config_path)
+        return -1;
+
+    n = config_load(config_path, &conf, &globals);
+    if (n < 0)
+    {
+        log_write(LOG_ERR, LOG_CLASS_GENERAL, "Failed to read %s, keeping the running config.", config_path);
+        return -1;
+    }
+
+    apply_globals();
+    log_write(LOG_INFO, LOG_CLASS_GENERAL, "Reloading %s.", config_path);
+
+    // Drop what went away first, then park every LED that changes hands, so
+    // neither the checks nor the pins see a binding on its way out
+    for (int i = 0; i < binding_count; i++)
+    {
+        BINDING *b = &bindings[i];
+        const INSTANCE_CONF *ic = find_instance(conf, n, b->name);
+
+        if (!b->stopped && (!ic || !ic->enabled))
+            release_binding(b);
+        else if (!b->stopped && strcmp(b->led, ic->led) != 0)
+        {
+            stop_animation(b);
+            if (b->pwm)
+                brightness_detach(b);
+            if (!b->offload)
+                led(b->led, "on");
+            b->led[0] = '\0';
+        }
+    }
+
+    for (int i = 0; i < binding_count; i++)
+    {
+        BINDING *b = &bindings[i];
+        const INSTANCE_CONF *ic = find_instance(conf, n, b->name);
+
+        if (b->stopped)
+            continue;
+        if (instance_usable(ic, b))
+            update_binding(b, ic);
+        else
+            release_binding(b);
+    }
+
+    // Stopped bindings give up their history so add_binding can reuse them
+    for (int i = 0; i < binding_count; i++)
+    {
+        if (!bindings[i].stopped)
+            continue;
+        history_close(bindings[i].hist);
+        bindings[i].hist = NULL;
+        group_free(bindings[i].group);
+        bindings[i].group = NULL;
+        close_readers(&bindings[i]);
+        publish_slot(&bindings[i]);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        INSTANCE_CONF *ic = &conf[i];
+        BINDING *b;
+
+        if (find_binding_by_name(ic->name) || !instance_usable(ic, NULL))
+            continue;
+        if (!(b = add_binding(ic->name, ic->ifname, ic->led)))
+            break;
+
+        apply_instance(b, ic);
+        b->group = make_group(ic);
+        attach_source(b, ic);
+
+        // A larger set needs a larger segment; readers pick it up when they reopen
+        if (stats_shm && binding_count > (int)stats_shm->count)
+        {
+            stats_destroy(stats_path, stats_shm);
+            stats_shm = stats_create(stats_path, binding_count);
+            for (int j = 0; j < binding_count; j++)
+                publish_slot(&bindings[j]);
+        }
+        start_binding(b);
+    }
+
+    prune_history();
+    free(conf);
+    return active_bindings();
+}
+
+// Control requests: list [if] | stop [if] | led <if> <lan|power> | counters | log [level] | reload
+void ctl_handler(const char *req, char *resp, size_t size)
+{
+    char cmd[16] = "", arg[IFNAMSIZ] = "", arg2[16] = "";
+    int len;
+
+    sscanf(req, "%15s %15s %15s", cmd, arg, arg2);
+
+    if (strcmp(cmd, "list") == 0)
+    {
+        len = snprintf(resp, size, "OK\n");
+        for (int i = 0; i < binding_count && len < (int)size; i++)
+        {
+            BINDING *b = &bindings[i];
+
+            if (b->stopped || (arg[0] && strcmp(arg, b->ifname) != 0))
+                continue;
+
+            len += snprintf(resp + len, size - len, "%s %s %s %d\n", b->name, b->ifname, b->led, getpid());
+        }
+    }
+    else if (strcmp(cmd, "stop") == 0)
+    {
+        BINDING *b = arg[0] ? find_binding_by_ifname(arg) : NULL;
+
+        if (arg[0] && !b)
+        {
+            snprintf(resp, size, "ERR %s is not monitored here\n", arg);
+            return;
+        }
+
+        for (int i = 0; i < binding_count; i++)
+        {
+            if (!bindings[i].stopped && (!b || b == &bindings[i]))
+                release_binding(&bindings[i]);
+        }
+
+        if (!active_bindings())
+            running = 0;
+        snprintf(resp, size, "OK %d %d\n", getpid(), active_bindings());
+    }
+    else if (strcmp(cmd, "led") == 0)
+    {
+        BINDING *b = find_binding_by_ifname(arg);
+        BINDING *other = find_binding_by_led(arg2);
+
+        if (!b)
+            snprintf(resp, size, "ERR %s is not monitored here\n", arg);
+        else if (!is_valid_led(arg2))
+            snprintf(resp, size, "ERR invalid LED '%s'\n", arg2);
+        else if (other && other != b)
+            snprintf(resp, size, "ERR LED '%s' is already in use\n", arg2);
+        else if (b->offload)
+            snprintf(resp, size, "ERR %s is offloaded to %s\n", arg, b->sysfs_led);
+        else
+        {
+            if (strcmp(b->led, arg2) != 0)
+            {
+                int pwm = b->pwm != NULL;
+
+                stop_animation(b);
+                if (pwm)
+                    brightness_detach(b);
+                led(b->led, "on");
+                snprintf(b->led, sizeof(b->led), "%s", arg2);
+                if (stats_shm)
+                    snprintf(stats_shm->slots[b - bindings].led, sizeof(stats_shm->slots[0].led), "%s", arg2);
+
+                // Let the next tick drive the new LED from scratch
+                b->led_state = LED_STATE_UNKNOWN;
+                b->lb_rate = -1;
+                b->lb_pattern = -1;
+                if (pwm && brightness_attach(b) < 0)
+                    log_write(LOG_WARNING, LOG_CLASS_GENERAL, "LED %s: PWM unavailable, blinking instead.", b->led);
+
+                log_write(LOG_NOTICE, LOG_CLASS_CTL, "Interface %s now drives LED %s.", b->ifname, b->led);
+            }
+            snprintf(resp, size, "OK\n");
+        }
+    }
+    else if (strcmp(cmd, "counters") == 0)
+    {
+        len = snprintf(resp, size, "OK\n");
+        format_counters(resp + len, size - len);
+    }
+    else if (strcmp(cmd, "reload") == 0)
+    {
+        int active = reload_bindings();
+
+        if (active < 0)
+            snprintf(resp, size, "ERR %s\n", config_path ? "failed to read the config" : "not started from a config");
+        else
+            snprintf(resp, size, "OK %d %d\n", getpid(), active);
+    }
+    else if (strcmp(cmd, "log") == 0)
+    {
+        // A level switches the daemon's syslog verbosity, ring/noring the debug ring; no argument dumps the ring
+        if (strcmp(arg, "ring") == 0 || strcmp(arg, "noring") == 0)
+        {
+            log_set_ring(arg[0] == 'r');
+            log_write(LOG_NOTICE, LOG_CLASS_CTL, "Debug ring %s.", arg[0] == 'r' ? "on" : "off");
+            snprintf(resp, size, "OK\n");
+        }
+        else if (arg[0])
+        {
+            int level = log_parse_level(arg);
+            if (level < 0)
+            {
+                snprintf(resp, size, "ERR unknown log level '%s'\n", arg);
+                return;
+            }
+            log_set_level(level);
+            log_write(LOG_NOTICE, LOG_CLASS_CTL, "Log level set to %s.", arg);
+            snprintf(resp, size, "OK\n");
+        }
+        else
+        {
+            len = snprintf(resp, size, "OK\n");
+            log_ring_dump(resp + len, size - len);
+        }
+    }
+    else
+    {
+        snprintf(resp, size, "ERR unknown command '%s'\n", cmd);
+    }
+}
+
+void run_loop()
+{
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (ep < 0 || tfd < 0)
+    {
+        log_write(LOG_ERR, LOG_CLASS_GENERAL, "Failed to set up the event loop.");
+        if (ep >= 0)
+            close(ep);
+        if (tfd >= 0)
+            close(tfd);
+        return;
+    }
+
+    struct timespec next;
+    int period = MAX_VAL;
+    long minute_start = monotonic_ms();
+    unsigned long wakeups = 0;
+    unsigned long wakeups_last_min = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    arm_tick(tfd, &next, period);
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = tfd};
+    epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+    if (mon_fd >= 0)
+    {
+        ev.data.fd = mon_fd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, mon_fd, &ev);
+    }
+    if (ctl_fd >= 0)
+    {
+        ev.data.fd = ctl_fd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, ctl_fd, &ev);
+    }
+
+    int timeout = -1;
+
+    while (running)
+    {
+        struct epoll_event events[4];
+        int n = epoll_wait(ep, events, 4, timeout);
+        if (n < 0)
+        {
+            if (errno != EINTR)
+                break;
+            n = 0;
+        }
+
+        wakeups++;
+        counters.wakeups++;
+        if (dump_requested)
+        {
+            dump_requested = 0;
+            log_counters();
+            log_ring_flush();
+        }
+        if (reload_requested)
+        {
+            reload_requested = 0;
+            reload_bindings();
+        }
+
+        if (monotonic_ms() - minute_start >= 60000)
+        {
+            wakeups_last_min = wakeups;
+            wakeups = 0;
+            minute_start += 60000;
+            log_write(LOG_DEBUG, LOG_CLASS_TRAFFIC, "Wakeups in the last minute: %lu", wakeups_last_min);
+        }
+
+        for (int i = 0; i < n && running; i++)
+        {
+            if (events[i].data.fd == tfd)
+            {
+                uint64_t expirations;
+                if (read(tfd, &expirations, sizeof(expirations)) > 0)
+                {
+                    record_tick(&next, period);
+                    tick();
+                }
+
+                int new_period = tick_period(monotonic_ms());
+                if (new_period != period)
+                {
+                    long window = monotonic_ms() - minute_start;
+                    unsigned long per_min = wakeups_last_min;
+
+                    if (!per_min && window > 0)
+                        per_min = wakeups * 60000 / window;
+                    log_write(LOG_INFO, LOG_CLASS_TRAFFIC, "Sampling every %d ms (%lu wakeups/min).", new_period, per_min);
+                    period = new_period;
+                }
+                arm_tick(tfd, &next, period);
+            }
+            else if (events[i].data.fd == mon_fd)
+            {
+                handle_link_events();
+            }
+            else if (events[i].data.fd == ctl_fd)
+            {
+                ctl_serve(ctl_fd, ctl_handler);
+            }
+        }
+
+        timeout = run_animations();
+    }
+
+    close(tfd);
+    close(ep);
+}
+
+// id names this daemon's control socket and stats file under RUN_DIR
+int run_daemon(const char *id)
+{
+    char ctl_path[128];
+
+    setup_signals();
+
+    log_open("trafmon");
+    apply_globals();
+
+    // The daemon holds its line requests for its whole lifetime, so it can use the chardev
+    gpio_set_backend(GPIO_BACKEND_AUTO);
+
+    log_write(LOG_INFO, LOG_CLASS_GENERAL, "Daemon started.");
+
+    build_curves();
+
+    // rtnetlink reports the real kernel, so a fake tree must be read through sysfs
+    if (hgl_root())
+        log_write(LOG_INFO, LOG_CLASS_GENERAL, "HGLEDON_ROOT set, sampling counters from sysfs.");
+    else if (!(use_rtnl = rtnl_open() == 0))
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "rtnetlink unavailable, sampling counters from sysfs.");
+    else
+        mon_fd = rtnl_monitor_open();
+
+    run_path(ctl_path, sizeof(ctl_path), id, "sock");
+    ctl_fd = ctl_listen(ctl_path);
+    if (ctl_fd < 0 && errno == EADDRINUSE)
+    {
+        // Taking over its socket and stats file would leave that daemon unreachable
+        log_write(LOG_ERR, LOG_CLASS_GENERAL, "Another trafmon daemon answers on %s, not starting.", ctl_path);
+        fprintf(stderr, "Another trafmon daemon answers on %s.\n", ctl_path);
+        rtnl_monitor_close();
+        rtnl_close();
+        log_close();
+        return EXIT_FAILURE;
+    }
+    if (ctl_fd < 0)
+    {
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "Failed to listen on %s, control commands disabled.", ctl_path);
+    }
+
+    run_path(stats_path, sizeof(stats_path), id, "stats");
+    stats_shm = stats_create(stats_path, binding_count);
+    if (!stats_shm)
+    {
+        log_write(LOG_WARNING, LOG_CLASS_GENERAL, "Failed to create %s, live stats disabled.", stats_path);
+    }
+
+    history_owner(id);
+    for (int i = 0; i < binding_count; i++)
+        start_binding(&bindings[i]);
+    prune_history();
+
+    run_loop();
+
+    for (int i = 0; i < binding_count; i++)
+    {
+        if (!bindings[i].stopped)
+            release_binding(&bindings[i]);
+        history_close(bindings[i].hist);
+        bindings[i].hist = NULL;
+        group_free(bindings[i].group);
+        bindings[i].group = NULL;
+        close_readers(&bindings[i]);
+    }
+    dump_attrs_sweep(1);
+
+    if (ctl_fd >= 0)
+    {
+        close(ctl_fd);
+        unlink(ctl_path);
+        ctl_fd = -1;
+    }
+    stats_destroy(stats_path, stats_shm);
+    stats_shm = NULL;
+    rtnl_monitor_close();
+    rtnl_close();
+    gpio_close_all();
+    log_write(LOG_INFO, LOG_CLASS_GENERAL, "Daemon stopped.");
+    log_close();
+    return EXIT_SUCCESS;
+}
+
+void daemonize()
+{
+    if (fork() > 0)
+        exit(EXIT_SUCCESS);
+    if (setsid() < 0)
+        exit(EXIT_FAILURE);
+
+    setup_signals();
+
+    if (fork() > 0)
+        exit(EXIT_SUCCESS);
+
+    umask(0);
+    chdir("/");
+
+    redirect_stdio_to_null();
+}
+
+// Build one binding per enabled 'config instance' section
+int load_bindings(const char *path)
+{
+    INSTANCE_CONF *conf;
+    BINDING *b;
+    char msg[128];
+    int n = config_load(path, &conf, &globals);
+
+    if (n < 0)
+    {
+        fprintf(stderr, "Failed to read %s\n", path);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        INSTANCE_CONF *ic = &conf[i];
+
+        if (!ic->enabled)
+            continue;
+
+        if (!ic->ifname[0])
+            snprintf(msg, sizeof(msg), "config '%s' missing ifname", ic->name);
+        else if (!is_valid_led(ic->led))
+            snprintf(msg, sizeof(msg), "config '%s': invalid LED '%s'", ic->name, ic->led);
+        else if (find_binding_by_led(ic->led))
+            snprintf(msg, sizeof(msg), "config '%s': LED '%s' is already in use", ic->name, ic->led);
+        else if (ic->offload && !ic->sysfs_led[0])
+            snprintf(msg, sizeof(msg), "config '%s': offload needs sysfs_led", ic->name);
+        else if (ic->offload && (is_group_conf(ic) || is_source_conf(ic)))
+            snprintf(msg, sizeof(msg), "config '%s': offload needs a single interface", ic->name);
+        else if (!(b = add_binding(ic->name, ic->ifname, ic->led)))
+            snprintf(msg, sizeof(msg), "config '%s': out of memory", ic->name);
+        else
+        {
+            apply_instance(b, ic);
+            b->group = make_group(ic);
+            attach_source(b, ic);
+            continue;
+        }
+
+        log_write(LOG_ERR, LOG_CLASS_GENERAL, "%s", msg);
+        fprintf(stderr, "%s\n", msg);
+    }
+
+    free(conf);
+    return binding_count;
+}
+
+void print_counters(const char *resp, void *arg)
+{
+    (void)arg;
+
+    if (strncmp(resp, "OK\n", 3) == 0)
+        printf("%s", resp + 3);
+}
+
+int show_counters()
+{
+    if (!ctl_foreach("counters", print_counters, NULL))
+    {
+        printf("No running trafmon instances found.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+void print_log(const char *resp, void *arg)
+{
+    (void)arg;
+
+    if (strncmp(resp, "OK\n", 3) == 0)
+        printf("%s", resp + 3);
+    else
+        fprintf(stderr, "%s", resp);
+}
+
+// "OK <pid> <active bindings>" or "ERR <reason>"
+void on_reloaded(const char *resp, void *arg)
+{
+    int *failed = arg;
+    int pid, active;
+
+    if (sscanf(resp, "OK %d %d", &pid, &active) == 2)
+    {
+        printf("Reloaded trafmon (PID: %d), %d instance(s) active.\n", pid, active);
+        return;
+    }
+    fprintf(stderr, "%s", resp);
+    (*failed)++;
+}
+
+int reload_instances()
+{
+    int failed = 0;
+
+    if (!ctl_foreach("reload", on_reloaded, &failed))
+    {
+        printf("No running trafmon instances found.\n");
+        return EXIT_FAILURE;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int show_log(const char *level)
+{
+    char req[32];
+    int count;
+
+    snprintf(req, sizeof(req), "log %s", level ? level : "");
+    count = ctl_foreach(req, print_log, NULL);
+    if (!count)
+    {
+        printf("No running trafmon instances found.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Range like 90s, 30m, 12h, 2d or 1w; the finest tier that fits in HISTORY_MAX_ROWS is shown
+int show_history(const char *iface, const char *range)
+{
+    static const char units[HISTORY_TIERS] = {'s', 'm', 'h'};
+    char *end;
+    long window = strtol(range, &end, 10);
+
+    switch (*end)
+    {
+    case 'w':
+        window *= 7;
+        // fall through
+    case 'd':
+        window *= 24;
+        // fall through
+    case 'h':
+        window *= 60;
+        // fall through
+    case 'm':
+        window *= 60;
+        // fall through
+    case 's':
+    case '\0':
+        break;
+    default:
+        window = 0;
+    }
+
+    if (window <= 0 || end == range)
+    {
+        fprintf(stderr, "Invalid range '%s'. Use e.g. 90s, 30m, 12h, 2d or 1w.\n", range);
+        return EXIT_FAILURE;
+    }
+
+    HIST_FILE *f = history_open(iface);
+    if (!f)
+    {
+        printf("No traffic history for %s.\n", iface);
+        return EXIT_FAILURE;
+    }
+
+    int t = 0;
+    while (t < HISTORY_TIERS - 1 && window / f->tiers[t].step > HISTORY_MAX_ROWS)
+        t++;
+
+    uint32_t step = f->tiers[t].step;
+    int rows = (window + step - 1) / step;
+    if (rows > (int)f->tiers[t].len)
+        rows = f->tiers[t].len;
+
+    HIST_BUCKET *buf = calloc(rows, sizeof(*buf));
+    int64_t last;
+    int n = buf ? history_read(f, t, buf, rows, &last) : -1;
+
+    if (n <= 0)
+    {
+        printf("No traffic history for %s yet.\n", iface);
+        free(buf);
+        history_unmap(f);
+        return n < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    long now_s = monotonic_ms() / 1000;
+    uint64_t sum_rx = 0, sum_tx = 0;
+    uint32_t peak_rx = 0, peak_tx = 0;
+
+    printf("Traffic history for %s, %d x %u s:\n", iface, n, step);
+    printf("%10s %12s %12s\n", "age", "RX KB/s", "TX KB/s");
+
+    for (int i = 0; i < n; i++)
+    {
+        // Age of the bucket's end, in the tier's own unit
+        long age = now_s - (long)((last - n + 2 + i) * step);
+        printf("%9ld%c %12.1f %12.1f\n", -(age / (long)step), units[t],
+               buf[i].rx / (double)KB, buf[i].tx / (double)KB);
+
+        sum_rx += buf[i].rx;
+        sum_tx += buf[i].tx;
+        peak_rx = buf[i].rx > peak_rx ? buf[i].rx : peak_rx;
+        peak_tx = buf[i].tx > peak_tx ? buf[i].tx : peak_tx;
+    }
+
+    printf("Average: RX %.1f KB/s, TX %.1f KB/s; peak: RX %.1f KB/s, TX %.1f KB/s\n",
+           sum_rx / (double)n / KB, sum_tx / (double)n / KB, peak_rx / (double)KB, peak_tx / (double)KB);
+
+    free(buf);
+    history_unmap(f);
+    return EXIT_SUCCESS;
+}
+
+void show_help(const char *prog)
+{
+    printf("\n");
+    printf("████████ ██████   █████  ███████ ███    ███  ██████  ███    ██ \n");
+    printf("   ██    ██   ██ ██   ██ ██      ████  ████ ██    ██ ████   ██ \n");
     printf("   ██    ██████  ███████ █████   ██ ████ ██ ██    ██ ██ ██  ██ \n");
     printf("   ██    ██   ██ ██   ██ ██      ██  ██  ██ ██    ██ ██  ██ ██ \n");
     printf("   ██    ██   ██ ██   ██ ██      ██      ██  ██████  ██   ████ \n");
@@ -677,6 +2687,12 @@ void show_help(const char *prog)
     printf("  %s stop [<interface>]       - Stop specific or all trafmon instances\n", prog);
     printf("  %s status [<interface>]     - Show status of specific or all instances\n", prog);
     printf("  %s list                     - List running instances\n", prog);
+    printf("  %s led <interface> <led>    - Move a running instance to another LED (lan|power)\n", prog);
+    printf("  %s counters                 - Dump the daemons' internal counters (also SIGUSR1 to syslog)\n", prog);
+    printf("  %s log [level|ring|noring]  - Dump the daemons' debug ring, set their syslog level, or start/stop the ring\n", prog);
+    printf("  %s history <name|interface> [range] - Show recorded throughput of a section (range: 90s, 30m, 12h, 2d, 1w; default 1h)\n", prog);
+    printf("  %s daemon [config]          - Run every enabled instance from %s in the foreground\n", prog, CONFIG_PATH);
+    printf("  %s reload                   - Make the daemon re-read its config and apply changes in place (also SIGHUP)\n", prog);
     printf("  %s help                     - Show this help message\n", prog);
     printf("\nCopyright (C) 2025 Najahi.\n");
 }
@@ -711,36 +2727,7 @@ int main(int argc, char *argv[])
         if (argc == 2)
         {
             printf("Stopping all running trafmon instances...\n");
-
-            DIR *d = opendir("/var/run");
-            if (!d)
-            {
-                perror("Failed to open /var/run");
-                return EXIT_FAILURE;
-            }
-
-            struct dirent *entry;
-            int found = 0;
-
-            while ((entry = readdir(d)) != NULL)
-            {
-                char iface[32];
-                if (parse_iface(entry->d_name, iface, sizeof(iface)))
-                {
-                    found = 1;
-                    printf(" → Stopping instance on interface: %s\n", iface);
-                    stop_process(iface);
-                }
-            }
-            closedir(d);
-
-            if (!found)
-            {
-                printf("No running trafmon instances found.\n");
-                return EXIT_FAILURE;
-            }
-
-            return EXIT_SUCCESS;
+            return stop_process(NULL);
         }
 
         fprintf(stderr, "Invalid usage. Use: %s stop [<interface>] or stop for stop all instances\n", prog);
@@ -757,37 +2744,7 @@ int main(int argc, char *argv[])
         }
 
         if (argc == 2)
-        {
-            int found = 0;
-            DIR *d = opendir("/var/run");
-            if (!d)
-            {
-                perror("Failed to open /var/run");
-                return EXIT_FAILURE;
-            }
-
-            struct dirent *entry;
-            while ((entry = readdir(d)) != NULL)
-            {
-                char iface[32];
-                if (parse_iface(entry->d_name, iface, sizeof(iface)))
-                {
-                    strncpy(interface_name, iface, sizeof(interface_name) - 1);
-                    interface_name[sizeof(interface_name) - 1] = '\0';
-                    check_status(interface_name);
-                    found = 1;
-                }
-            }
-            closedir(d);
-
-            if (!found)
-            {
-                printf("No running trafmon instances found.\n");
-                return EXIT_FAILURE;
-            }
-
-            return EXIT_SUCCESS;
-        }
+            return check_status(NULL);
 
         fprintf(stderr, "Invalid usage. Use: %s status [<interface>]\n", prog);
         return EXIT_FAILURE;
@@ -798,13 +2755,36 @@ int main(int argc, char *argv[])
         return list_instances();
     }
 
+    if (argc == 2 && strcmp(argv[1], "counters") == 0)
+    {
+        return show_counters();
+    }
+
+    if (argc == 2 && strcmp(argv[1], "reload") == 0)
+    {
+        return reload_instances();
+    }
+
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "log") == 0)
+    {
+        return show_log(argc == 3 ? argv[2] : NULL);
+    }
+
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "history") == 0)
+    {
+        return show_history(argv[2], argc == 4 ? argv[3] : "1h");
+    }
+
+    if (argc == 4 && strcmp(argv[1], "led") == 0)
+    {
+        return set_instance_led(argv[2], argv[3]);
+    }
+
     if (strcmp(argv[1], "start") == 0 && (argc == 3 || argc == 4))
     {
         strncpy(interface_name, argv[2], sizeof(interface_name) - 1);
         interface_name[sizeof(interface_name) - 1] = '\0';
 
-        set_file_paths(interface_name);
-
         if (argc == 4)
         {
             const char *user_led = argv[3];
@@ -828,23 +2808,49 @@ int main(int argc, char *argv[])
             select_led_for_instance();
         }
 
-        if (check_running())
+        if (check_running(interface_name))
         {
             printf("Traffic monitor already running!\n");
             return EXIT_FAILURE;
         }
 
-        snprintf(log_buf, sizeof(log_buf),
-                 "Starting traffic monitor for interface %s with led %s...\n", interface_name, led_name);
-        log_msg(log_buf);
+        log_write(LOG_INFO, LOG_CLASS_GENERAL, "Starting traffic monitor for interface %s with led %s...", interface_name, led_name);
 
         printf("Starting traffic monitor for interface %s with led %s...\n", interface_name, led_name);
+        fflush(stdout);
+
+        char id[64];
+        snprintf(id, sizeof(id), "cli-%s", interface_name);
 
         daemonize();
-        monitor_traffic();
-        remove_lock_file();
+        add_binding("cli", interface_name, led_name);
+        return run_daemon(id);
+    }
 
-        return EXIT_SUCCESS;
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "daemon") == 0)
+    {
+        const char *config = argc == 3 ? argv[2] : CONFIG_PATH;
+
+        if (load_bindings(config) < 0)
+            return EXIT_FAILURE;
+        config_path = config;
+
+        for (int i = 0; i < binding_count; i++)
+        {
+            if (check_running(bindings[i].ifname))
+            {
+                fprintf(stderr, "Traffic monitor for %s already running!\n", bindings[i].ifname);
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (!binding_count)
+        {
+            printf("No enabled trafmon instances in %s.\n", config);
+            return EXIT_SUCCESS;
+        }
+
+        return run_daemon("daemon");
     }
 
     fprintf(stderr, "Invalid usage. Use '%s help' for usage information.\n", prog);